@@ -0,0 +1,712 @@
+//
+//  RZDBBenchmarks.m
+//  RZDBBenchmarks
+//
+//  Microbenchmarks for RZDataBinding. Each result is printed to stdout as a single line of JSON,
+//  so runs can be saved and compared across commits:
+//
+//  {"benchmark":"fanout","parameter":100,"ops":10000,"ns_per_op":1234.5,"allocs_per_op":3.0,"bytes_per_op":0.0,"peak_rss_bytes":12345678}
+//
+//  bytes_per_op is the change in live heap bytes, so it is negative for benchmarks that free memory.
+//
+//  Usage: rzdb-bench [--max-observers N] [add_remove] [concurrent_registration] [deep_hierarchy_registration] [fanout] [fanout_recording] [bind_chain] [coalesce_commit] [coalesce_cycle] [cleanup_on_dealloc] [dealloc] [repoint] [bind_memory] [callback_memory]
+//  With no names, every benchmark runs. Peak RSS is for the whole process, so run benchmarks one at a time to compare memory.
+//  fanout_recording only exists when built with RZDB_INSTRUMENTATION=1.
+//
+
+#import <Foundation/Foundation.h>
+#import <objc/runtime.h>
+#import <stdatomic.h>
+#import <time.h>
+#import <sys/resource.h>
+
+#if defined(__APPLE__)
+#import <malloc/malloc.h>
+#import <mach/mach.h>
+#else
+#import <malloc.h>
+#endif
+
+#import "RZDataBinding.h"
+
+#pragma mark - Allocation counting
+
+static atomic_ullong s_allocationCount = 0;
+static atomic_llong s_liveBytes = 0;
+
+#if defined(__APPLE__)
+
+// count allocations by wrapping the default malloc zone's functions
+static void* (*s_zoneMalloc)(malloc_zone_t *, size_t);
+static void* (*s_zoneCalloc)(malloc_zone_t *, size_t, size_t);
+static void* (*s_zoneRealloc)(malloc_zone_t *, void *, size_t);
+static void (*s_zoneFree)(malloc_zone_t *, void *);
+
+static inline void rz_benchTrackBytes(const void *ptr, long long sign)
+{
+    if ( ptr != NULL ) {
+        atomic_fetch_add_explicit(&s_liveBytes, sign * (long long)malloc_size(ptr), memory_order_relaxed);
+    }
+}
+
+static void* rz_benchZoneMalloc(malloc_zone_t *zone, size_t size)
+{
+    atomic_fetch_add_explicit(&s_allocationCount, 1, memory_order_relaxed);
+
+    void *result = s_zoneMalloc(zone, size);
+    rz_benchTrackBytes(result, 1);
+
+    return result;
+}
+
+static void* rz_benchZoneCalloc(malloc_zone_t *zone, size_t count, size_t size)
+{
+    atomic_fetch_add_explicit(&s_allocationCount, 1, memory_order_relaxed);
+
+    void *result = s_zoneCalloc(zone, count, size);
+    rz_benchTrackBytes(result, 1);
+
+    return result;
+}
+
+static void* rz_benchZoneRealloc(malloc_zone_t *zone, void *ptr, size_t size)
+{
+    atomic_fetch_add_explicit(&s_allocationCount, 1, memory_order_relaxed);
+    rz_benchTrackBytes(ptr, -1);
+
+    void *result = s_zoneRealloc(zone, ptr, size);
+    rz_benchTrackBytes(result ?: ptr, 1);
+
+    return result;
+}
+
+static void rz_benchZoneFree(malloc_zone_t *zone, void *ptr)
+{
+    rz_benchTrackBytes(ptr, -1);
+    s_zoneFree(zone, ptr);
+}
+
+static void rz_benchInstallAllocationCounter(void)
+{
+    malloc_zone_t *zone = malloc_default_zone();
+
+    // the default zone is read only on recent systems
+    vm_protect(mach_task_self(), (vm_address_t)zone, sizeof(*zone), 0, VM_PROT_READ | VM_PROT_WRITE);
+
+    s_zoneMalloc = zone->malloc;
+    s_zoneCalloc = zone->calloc;
+    s_zoneRealloc = zone->realloc;
+    s_zoneFree = zone->free;
+
+    zone->malloc = rz_benchZoneMalloc;
+    zone->calloc = rz_benchZoneCalloc;
+    zone->realloc = rz_benchZoneRealloc;
+    zone->free = rz_benchZoneFree;
+
+    vm_protect(mach_task_self(), (vm_address_t)zone, sizeof(*zone), 0, VM_PROT_READ);
+}
+
+static uint64_t rz_benchPeakRSS(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    // bytes on Darwin
+    return (uint64_t)usage.ru_maxrss;
+}
+
+#else
+
+// count allocations by interposing the C allocator, which glibc allows the executable to do
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static inline void rz_benchTrackBytes(void *ptr, long long sign)
+{
+    if ( ptr != NULL ) {
+        atomic_fetch_add_explicit(&s_liveBytes, sign * (long long)malloc_usable_size(ptr), memory_order_relaxed);
+    }
+}
+
+void* malloc(size_t size)
+{
+    atomic_fetch_add_explicit(&s_allocationCount, 1, memory_order_relaxed);
+
+    void *result = __libc_malloc(size);
+    rz_benchTrackBytes(result, 1);
+
+    return result;
+}
+
+void* calloc(size_t count, size_t size)
+{
+    atomic_fetch_add_explicit(&s_allocationCount, 1, memory_order_relaxed);
+
+    void *result = __libc_calloc(count, size);
+    rz_benchTrackBytes(result, 1);
+
+    return result;
+}
+
+void* realloc(void *ptr, size_t size)
+{
+    atomic_fetch_add_explicit(&s_allocationCount, 1, memory_order_relaxed);
+    rz_benchTrackBytes(ptr, -1);
+
+    void *result = __libc_realloc(ptr, size);
+    rz_benchTrackBytes(result ?: ptr, 1);
+
+    return result;
+}
+
+void free(void *ptr)
+{
+    rz_benchTrackBytes(ptr, -1);
+    __libc_free(ptr);
+}
+
+static void rz_benchInstallAllocationCounter(void)
+{
+    // nothing to do, the allocator is interposed at link time
+}
+
+static uint64_t rz_benchPeakRSS(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    // kilobytes on Linux
+    return (uint64_t)usage.ru_maxrss * 1024;
+}
+
+#endif
+
+#pragma mark - Reporting
+
+static NSArray *s_filters = nil;
+
+static BOOL rz_benchShouldRun(NSString *benchmark)
+{
+    return (s_filters.count == 0 || [s_filters containsObject:benchmark]);
+}
+
+static uint64_t rz_benchNow(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t)time.tv_sec * NSEC_PER_SEC + (uint64_t)time.tv_nsec;
+}
+
+// times the work block, which should perform ops operations, and prints the result.
+// Setup and teardown should happen outside the block so they aren't measured.
+static void rz_benchMeasure(const char *benchmark, NSUInteger parameter, NSUInteger ops, void (^work)(void))
+{
+    unsigned long long allocations = atomic_load_explicit(&s_allocationCount, memory_order_relaxed);
+    long long liveBytes = atomic_load_explicit(&s_liveBytes, memory_order_relaxed);
+    uint64_t start = rz_benchNow();
+
+    @autoreleasepool {
+        work();
+    }
+
+    uint64_t elapsed = rz_benchNow() - start;
+    allocations = atomic_load_explicit(&s_allocationCount, memory_order_relaxed) - allocations;
+    liveBytes = atomic_load_explicit(&s_liveBytes, memory_order_relaxed) - liveBytes;
+
+    printf("{\"benchmark\":\"%s\",\"parameter\":%lu,\"ops\":%lu,\"ns_per_op\":%.1f,\"allocs_per_op\":%.2f,\"bytes_per_op\":%.1f,\"peak_rss_bytes\":%llu}\n",
+           benchmark, (unsigned long)parameter, (unsigned long)ops,
+           (double)elapsed / ops, (double)allocations / ops, (double)liveBytes / ops,
+           (unsigned long long)rz_benchPeakRSS());
+
+    fflush(stdout);
+}
+
+#pragma mark - RZDBBenchmarkObject
+
+@interface RZDBBenchmarkObject : NSObject
+
+@property (copy, nonatomic) NSString *string;
+@property (assign, nonatomic) NSInteger value;
+@property (assign, nonatomic) NSUInteger callbackCount;
+@property (strong, nonatomic) RZDBBenchmarkObject *child;
+
+- (void)changed;
+
+// for callbacks that may be sent on several threads at once
+- (void)changedConcurrently;
+
+@end
+
+static atomic_ullong s_concurrentCallbackCount = 0;
+
+@implementation RZDBBenchmarkObject
+
+- (void)changed
+{
+    self.callbackCount++;
+}
+
+- (void)changedConcurrently
+{
+    atomic_fetch_add_explicit(&s_concurrentCallbackCount, 1, memory_order_relaxed);
+}
+
+@end
+
+static NSArray* rz_benchObjects(NSUInteger count)
+{
+    NSMutableArray *objects = [NSMutableArray arrayWithCapacity:count];
+
+    for ( NSUInteger i = 0; i < count; i++ ) {
+        [objects addObject:[RZDBBenchmarkObject new]];
+    }
+
+    return objects;
+}
+
+#pragma mark - Benchmarks
+
+// registering and removing n targets for a key path of a single object
+static void rz_benchAddRemove(NSUInteger maxObservers)
+{
+    for ( NSUInteger n = 1000; n <= maxObservers; n *= 10 ) {
+        RZDBBenchmarkObject *object = [RZDBBenchmarkObject new];
+        NSArray *targets = rz_benchObjects(n);
+
+        rz_benchMeasure("add", n, n, ^{
+            for ( RZDBBenchmarkObject *target in targets ) {
+                [object rz_addTarget:target action:@selector(changed) forKeyPathChange:@"value"];
+            }
+        });
+
+        rz_benchMeasure("remove", n, n, ^{
+            for ( RZDBBenchmarkObject *target in targets ) {
+                [object rz_removeTarget:target action:@selector(changed) forKeyPathChange:@"value"];
+            }
+        });
+    }
+}
+
+// register/notify/remove cycles split across a number of threads. Half of the cycles contend on a shared object,
+// and the other half use an object private to each thread.
+static void rz_benchConcurrentRegistration(void)
+{
+    static const NSUInteger kIterations = 20000;
+
+    RZDBBenchmarkObject *sharedObject = [RZDBBenchmarkObject new];
+
+    for ( NSUInteger threadCount = 1; threadCount <= 8; threadCount *= 2 ) {
+        NSArray *targets = rz_benchObjects(threadCount);
+        NSArray *privateObjects = rz_benchObjects(threadCount);
+
+        atomic_store_explicit(&s_concurrentCallbackCount, 0, memory_order_relaxed);
+
+        rz_benchMeasure("concurrent_registration", threadCount, kIterations, ^{
+            dispatch_apply(threadCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t thread) {
+                RZDBBenchmarkObject *target = targets[thread];
+
+                for ( NSUInteger i = 0; i < kIterations / threadCount; i++ ) {
+                    @autoreleasepool {
+                        RZDBBenchmarkObject *object = (i % 2 == 0) ? sharedObject : privateObjects[thread];
+
+                        [object rz_addTarget:target action:@selector(changedConcurrently) forKeyPathChange:@"value"];
+                        object.value = (NSInteger)i;
+                        [object rz_removeTarget:target action:@selector(changedConcurrently) forKeyPathChange:@"value"];
+                    }
+                }
+            });
+        });
+
+        NSCAssert(atomic_load_explicit(&s_concurrentCallbackCount, memory_order_relaxed) >= kIterations, @"A change made while registered wasn't delivered.");
+    }
+}
+
+// registering and removing a target whose class is depth levels below RZDBBenchmarkObject, which is observed by an object
+// of the same class. Registration checks that every class has had dealloc swizzled for cleanup.
+static void rz_benchDeepHierarchyRegistration(void)
+{
+    static const NSUInteger kIterations = 10000;
+    static const NSUInteger kMaxDepth = 64;
+
+    NSMutableArray *classes = [NSMutableArray arrayWithObject:[RZDBBenchmarkObject class]];
+
+    for ( NSUInteger i = 1; i <= kMaxDepth; i++ ) {
+        NSString *className = [NSString stringWithFormat:@"RZDBDeepBenchmarkObject%lu", (unsigned long)i];
+        Class subclass = objc_allocateClassPair(classes.lastObject, className.UTF8String, 0);
+        objc_registerClassPair(subclass);
+
+        [classes addObject:subclass];
+    }
+
+    for ( NSUInteger depth = 1; depth <= kMaxDepth; depth *= 4 ) {
+        RZDBBenchmarkObject *object = [classes[depth] new];
+        RZDBBenchmarkObject *target = [classes[depth] new];
+
+        rz_benchMeasure("deep_hierarchy_registration", depth, kIterations, ^{
+            for ( NSUInteger i = 0; i < kIterations; i++ ) {
+                [object rz_addTarget:target action:@selector(changed) forKeyPathChange:@"value"];
+                [object rz_removeTarget:target action:@selector(changed) forKeyPathChange:@"value"];
+            }
+        });
+    }
+}
+
+// the cost of a single change observed by k targets
+static void rz_benchFanout(void)
+{
+    static const NSUInteger kChanges = 10000;
+
+    for ( NSUInteger k = 1; k <= 1000; k *= 10 ) {
+        RZDBBenchmarkObject *object = [RZDBBenchmarkObject new];
+        NSArray *targets = rz_benchObjects(k);
+
+        for ( RZDBBenchmarkObject *target in targets ) {
+            [object rz_addTarget:target action:@selector(changed) forKeyPathChange:@"value"];
+        }
+
+        rz_benchMeasure("fanout", k, kChanges, ^{
+            for ( NSUInteger i = 1; i <= kChanges; i++ ) {
+                object.value = (NSInteger)i;
+            }
+        });
+    }
+}
+
+#if RZDB_INSTRUMENTATION
+// the fanout benchmark while recording, to compare with fanout in the same build
+static void rz_benchFanoutRecording(void)
+{
+    static const NSUInteger kChanges = 10000;
+
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"rzdb-bench.rzdb"];
+
+    [RZDBInstrumentation startRecordingToFile:path capacity:1 << 16];
+
+    for ( NSUInteger k = 1; k <= 1000; k *= 10 ) {
+        RZDBBenchmarkObject *object = [RZDBBenchmarkObject new];
+        NSArray *targets = rz_benchObjects(k);
+
+        for ( RZDBBenchmarkObject *target in targets ) {
+            [object rz_addTarget:target action:@selector(changed) forKeyPathChange:@"value"];
+        }
+
+        rz_benchMeasure("fanout_recording", k, kChanges, ^{
+            for ( NSUInteger i = 1; i <= kChanges; i++ ) {
+                object.value = (NSInteger)i;
+            }
+        });
+    }
+
+    [RZDBInstrumentation stopRecording];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+}
+#endif
+
+// the cost of a change propagating through a chain of length bindings
+static void rz_benchBindChain(void)
+{
+    static const NSUInteger kChanges = 10000;
+
+    for ( NSUInteger length = 1; length <= 100; length *= 10 ) {
+        NSArray *objects = rz_benchObjects(length + 1);
+
+        for ( NSUInteger i = 1; i <= length; i++ ) {
+            [objects[i] rz_bindKey:@"value" toKeyPath:@"value" ofObject:objects[i - 1]];
+        }
+
+        RZDBBenchmarkObject *head = objects.firstObject;
+
+        rz_benchMeasure("bind_chain", length, kChanges, ^{
+            for ( NSUInteger i = 1; i <= kChanges; i++ ) {
+                head.value = (NSInteger)i;
+            }
+        });
+
+        NSCAssert([objects.lastObject value] == (NSInteger)kChanges, @"Binding chain didn't propagate.");
+    }
+}
+
+// the cost per notification of an RZDBCoalesce that collects n notifications
+static void rz_benchCoalesceCommit(void)
+{
+    static const NSUInteger kRepetitions = 10;
+
+    for ( NSUInteger n = 10; n <= 10000; n *= 10 ) {
+        NSArray *objects = rz_benchObjects(n);
+        RZDBBenchmarkObject *target = [RZDBBenchmarkObject new];
+
+        for ( RZDBBenchmarkObject *object in objects ) {
+            [object rz_addTarget:target action:@selector(changed) forKeyPathChange:@"value" options:RZDBObservationOptionCoalesce];
+        }
+
+        rz_benchMeasure("coalesce_commit", n, n * kRepetitions, ^{
+            for ( NSUInteger r = 1; r <= kRepetitions; r++ ) {
+                [RZDBCoalesce begin];
+
+                for ( RZDBBenchmarkObject *object in objects ) {
+                    object.value = (NSInteger)r;
+                }
+
+                [RZDBCoalesce commit];
+            }
+        });
+    }
+}
+
+// the cost of a begin/change/commit cycle that coalesces two changes to one observed key path into one callback.
+// Every change looks up the current coalesce, and every begin and commit sets it.
+static void rz_benchCoalesceCycle(void)
+{
+    static const NSUInteger kCycles = 100000;
+
+    RZDBBenchmarkObject *object = [RZDBBenchmarkObject new];
+    RZDBBenchmarkObject *target = [RZDBBenchmarkObject new];
+
+    [object rz_addTarget:target action:@selector(changed) forKeyPathChange:@"value" options:RZDBObservationOptionCoalesce];
+
+    rz_benchMeasure("coalesce_cycle", 1, kCycles, ^{
+        for ( NSUInteger i = 1; i <= kCycles; i++ ) {
+            [RZDBCoalesce begin];
+            object.value = (NSInteger)i;
+            object.value = 0;
+            [RZDBCoalesce commit];
+        }
+    });
+
+    NSCAssert(target.callbackCount == kCycles, @"Each coalesce should have sent exactly one callback.");
+}
+
+// the cost of deallocating an object, including rz_cleanupObservers, that has k callbacks and k bindings
+static void rz_benchCleanupOnDealloc(void)
+{
+    static const NSUInteger kObjects = 10000;
+
+    for ( NSUInteger k = 1; k <= 100; k *= 10 ) {
+        RZDBBenchmarkObject *target = [RZDBBenchmarkObject new];
+        RZDBBenchmarkObject *source = [RZDBBenchmarkObject new];
+        NSMutableArray *objects = [NSMutableArray arrayWithCapacity:kObjects];
+
+        @autoreleasepool {
+            for ( NSUInteger i = 0; i < kObjects; i++ ) {
+                RZDBBenchmarkObject *object = [RZDBBenchmarkObject new];
+
+                for ( NSUInteger j = 0; j < k; j++ ) {
+                    [object rz_addTarget:target action:@selector(changed) forKeyPathChange:@"value"];
+                    [object rz_bindKey:@"string" toKeyPath:@"string" ofObject:source];
+                }
+
+                [objects addObject:object];
+            }
+        }
+
+        rz_benchMeasure("cleanup_on_dealloc", k, kObjects, ^{
+            [objects removeAllObjects];
+        });
+    }
+}
+
+// the cost per observer of deallocating objects with n observers each, both as the observed object
+// (n targets observe it) and as the target (it observes n objects)
+static void rz_benchDealloc(void)
+{
+    static const NSUInteger kObservers = 100000;
+
+    for ( NSUInteger n = 10; n <= 10000; n *= 10 ) {
+        NSUInteger count = kObservers / n;
+        NSArray *targets = rz_benchObjects(n);
+        NSMutableArray *objects = [NSMutableArray arrayWithCapacity:count];
+
+        @autoreleasepool {
+            for ( NSUInteger i = 0; i < count; i++ ) {
+                RZDBBenchmarkObject *object = [RZDBBenchmarkObject new];
+
+                for ( RZDBBenchmarkObject *target in targets ) {
+                    [object rz_addTarget:target action:@selector(changed) forKeyPathChange:@"value"];
+                }
+
+                [objects addObject:object];
+            }
+        }
+
+        rz_benchMeasure("dealloc_observed", n, count * n, ^{
+            [objects removeAllObjects];
+        });
+
+        NSArray *sources = rz_benchObjects(n);
+
+        @autoreleasepool {
+            for ( NSUInteger i = 0; i < count; i++ ) {
+                RZDBBenchmarkObject *object = [RZDBBenchmarkObject new];
+
+                for ( RZDBBenchmarkObject *source in sources ) {
+                    [source rz_addTarget:object action:@selector(changed) forKeyPathChange:@"value"];
+                }
+
+                [objects addObject:object];
+            }
+        }
+
+        rz_benchMeasure("dealloc_target", n, count * n, ^{
+            [objects removeAllObjects];
+        });
+    }
+}
+
+// the cost of replacing the first intermediate object of 2 * depth observed key paths that share their prefixes,
+// one for each of two keys at every depth from 1 to depth below the replaced object
+static void rz_benchRepoint(void)
+{
+    static const NSUInteger kChanges = 1000;
+
+    for ( NSUInteger depth = 1; depth <= 16; depth *= 2 ) {
+        RZDBBenchmarkObject *root = [RZDBBenchmarkObject new];
+        NSArray *targets = rz_benchObjects(2 * depth);
+        NSMutableArray *chains = [NSMutableArray array];
+
+        for ( NSUInteger c = 0; c < 2; c++ ) {
+            RZDBBenchmarkObject *head = [RZDBBenchmarkObject new];
+            RZDBBenchmarkObject *last = head;
+
+            for ( NSUInteger i = 0; i < depth; i++ ) {
+                last.child = [RZDBBenchmarkObject new];
+                last = last.child;
+            }
+
+            [chains addObject:head];
+        }
+
+        root.child = chains[0];
+
+        NSMutableString *keyPath = [NSMutableString stringWithString:@"child"];
+
+        for ( NSUInteger i = 0; i < depth; i++ ) {
+            [keyPath appendString:@".child"];
+
+            [root rz_addTarget:targets[2 * i] action:@selector(changed) forKeyPathChange:[keyPath stringByAppendingString:@".value"]];
+            [root rz_addTarget:targets[2 * i + 1] action:@selector(changed) forKeyPathChange:[keyPath stringByAppendingString:@".string"]];
+        }
+
+        rz_benchMeasure("repoint", depth, kChanges, ^{
+            for ( NSUInteger i = 1; i <= kChanges; i++ ) {
+                root.child = chains[i % 2];
+            }
+        });
+
+        NSCAssert([targets.lastObject callbackCount] == kChanges, @"Replacing an intermediate object didn't notify.");
+    }
+}
+
+// the heap retained by each of n live bindings. Key paths are built at runtime, as they
+// often are in apps (e.g. from NSStringFromSelector), so that each registration passes a distinct string.
+static void rz_benchBindMemory(NSUInteger maxObservers)
+{
+    for ( NSUInteger n = 1000; n <= maxObservers; n *= 10 ) {
+        RZDBBenchmarkObject *source = [RZDBBenchmarkObject new];
+        NSArray *targets = rz_benchObjects(n);
+
+        rz_benchMeasure("bind_memory", n, n, ^{
+            for ( RZDBBenchmarkObject *target in targets ) {
+                [target rz_bindKey:NSStringFromSelector(@selector(string)) toKeyPath:NSStringFromSelector(@selector(string)) ofObject:source];
+            }
+        });
+    }
+}
+
+// the heap retained by each of n live callbacks, with key paths built at runtime as in bind_memory
+static void rz_benchCallbackMemory(NSUInteger maxObservers)
+{
+    for ( NSUInteger n = 1000; n <= maxObservers; n *= 10 ) {
+        RZDBBenchmarkObject *source = [RZDBBenchmarkObject new];
+        NSArray *targets = rz_benchObjects(n);
+
+        rz_benchMeasure("callback_memory", n, n, ^{
+            for ( RZDBBenchmarkObject *target in targets ) {
+                [source rz_addTarget:target action:@selector(changed) forKeyPathChange:NSStringFromSelector(@selector(value))];
+            }
+        });
+    }
+}
+
+#pragma mark - main
+
+int main(int argc, const char *argv[])
+{
+    @autoreleasepool {
+        NSMutableArray *filters = [NSMutableArray array];
+        NSUInteger maxObservers = 100000;
+
+        NSArray *arguments = [NSProcessInfo processInfo].arguments;
+
+        for ( NSUInteger i = 1; i < arguments.count; i++ ) {
+            if ( [arguments[i] isEqualToString:@"--max-observers"] && i + 1 < arguments.count ) {
+                maxObservers = (NSUInteger)[arguments[++i] longLongValue];
+            }
+            else {
+                [filters addObject:arguments[i]];
+            }
+        }
+
+        s_filters = filters;
+
+        rz_benchInstallAllocationCounter();
+
+        if ( rz_benchShouldRun(@"add_remove") ) {
+            rz_benchAddRemove(maxObservers);
+        }
+
+        if ( rz_benchShouldRun(@"concurrent_registration") ) {
+            rz_benchConcurrentRegistration();
+        }
+
+        if ( rz_benchShouldRun(@"deep_hierarchy_registration") ) {
+            rz_benchDeepHierarchyRegistration();
+        }
+
+        if ( rz_benchShouldRun(@"fanout") ) {
+            rz_benchFanout();
+        }
+
+#if RZDB_INSTRUMENTATION
+        if ( rz_benchShouldRun(@"fanout_recording") ) {
+            rz_benchFanoutRecording();
+        }
+#endif
+
+        if ( rz_benchShouldRun(@"bind_chain") ) {
+            rz_benchBindChain();
+        }
+
+        if ( rz_benchShouldRun(@"coalesce_commit") ) {
+            rz_benchCoalesceCommit();
+        }
+
+        if ( rz_benchShouldRun(@"coalesce_cycle") ) {
+            rz_benchCoalesceCycle();
+        }
+
+        if ( rz_benchShouldRun(@"cleanup_on_dealloc") ) {
+            rz_benchCleanupOnDealloc();
+        }
+
+        if ( rz_benchShouldRun(@"dealloc") ) {
+            rz_benchDealloc();
+        }
+
+        if ( rz_benchShouldRun(@"repoint") ) {
+            rz_benchRepoint();
+        }
+
+        if ( rz_benchShouldRun(@"bind_memory") ) {
+            rz_benchBindMemory(maxObservers);
+        }
+
+        if ( rz_benchShouldRun(@"callback_memory") ) {
+            rz_benchCallbackMemory(maxObservers);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1 @@
+../../../../RZDataBinding/RZDBRecordFormat.h
\ No newline at end of file
@@ -50,6 +50,84 @@ OBJC_EXTERN NSString* const kRZDBChangeKeyNew;
  */
 OBJC_EXTERN NSString* const kRZDBChangeKeyKeyPath;
 
+/**
+ *  If present, the value for this key is an NSNumber containing the NSKeyValueChange kind of a change to an ordered to-many key path.
+ *  For an insertion, removal or replacement, kRZDBChangeKeyNew and kRZDBChangeKeyOld contain arrays of only the inserted or removed objects.
+ *  This key is absent for changes that set the whole value of a key path.
+ */
+OBJC_EXTERN NSString* const kRZDBChangeKeyKind;
+
+/**
+ *  If present, the value for this key is an NSIndexSet of the indexes inserted, removed or replaced by a to-many change.
+ */
+OBJC_EXTERN NSString* const kRZDBChangeKeyIndexes;
+
+/**
+ *  If present, the value for this key is an NSIndexSet of indexes removed from the original collection.
+ *  Only present when several to-many changes of different kinds are coalesced or batched together into a single net change.
+ *  In that case the kind is NSKeyValueChangeSetting, kRZDBChangeKeyNew is the whole final collection,
+ *  and applying the removals and then the insertions to the original collection produces the final collection.
+ */
+OBJC_EXTERN NSString* const kRZDBChangeKeyRemovedIndexes;
+
+/**
+ *  If present, the value for this key is an NSIndexSet of indexes inserted into the final collection.
+ *  Always present together with kRZDBChangeKeyRemovedIndexes.
+ */
+OBJC_EXTERN NSString* const kRZDBChangeKeyInsertedIndexes;
+
+/**
+ *  Options that modify how callbacks registered with the rz_addTarget:action: methods are sent.
+ */
+typedef NS_OPTIONS(NSUInteger, RZDBObservationOptions) {
+    /**
+     *  The default behavior: the action is called synchronously whenever the key path changes.
+     */
+    RZDBObservationOptionNone = 0,
+
+    /**
+     *  The action is also called immediately before the registration method returns.
+     *  In this case the change dictionary, if present, will not contain a value for kRZDBChangeKeyOld.
+     */
+    RZDBObservationOptionCallImmediately = 1 << 0,
+
+    /**
+     *  If the callback occurs during an RZDBCoalesce event, it is coalesced and deferred until the coalesce is committed.
+     *  This is equivalent to using an rz_coalesceProxy as the target, but without the overhead of message forwarding.
+     *  Successive changes to an ordered to-many key path are merged into a single net change.
+     *
+     *  @see RZDBCoalesce
+     */
+    RZDBObservationOptionCoalesce = 1 << 1,
+
+    /**
+     *  The action is called at most once per interval. The first change is delivered right away, and later changes
+     *  within the interval are delivered together when it ends. Requires a positive interval.
+     *  A delivered change dictionary has the latest value for kRZDBChangeKeyNew, and the earliest value for kRZDBChangeKeyOld.
+     *
+     *  @see rz_addTarget:action:forKeyPathChanges:options:interval:queue:
+     */
+    RZDBObservationOptionThrottle = 1 << 2,
+
+    /**
+     *  The action is called only once the key path has stopped changing for the interval. Requires a positive interval.
+     *  A delivered change dictionary has the latest value for kRZDBChangeKeyNew, and the earliest value for kRZDBChangeKeyOld.
+     *
+     *  @see rz_addTarget:action:forKeyPathChanges:options:interval:queue:
+     */
+    RZDBObservationOptionDebounce = 1 << 3,
+
+    /**
+     *  Bindings and callbacks with this option take part in ordered propagation. When a key path changes, every ordered binding
+     *  that depends on it, directly or through other ordered bindings, is set exactly once, in topological order of the binding graph,
+     *  from the current values of its key path. Ordered callbacks and the values of observed RZDBDerivedValues are sent
+     *  once each, after the ordered bindings have been set, so they never see inconsistent intermediate values.
+     *
+     *  @note Ordering applies to bindings made on the same thread as the change. Asynchronous and rate limited deliveries are not ordered.
+     */
+    RZDBObservationOptionOrdered = 1 << 4,
+};
+
 /**
  *  Set this to 1 (recommended) to enable automatic cleanup of observers on object deallocation.
  *  If enabled, it is safe to observe or bind to weak references, and there is no need to call rz_removeTarget
@@ -68,6 +146,28 @@ OBJC_EXTERN NSString* const kRZDBChangeKeyKeyPath;
 #define RZDB_AUTOMATIC_CLEANUP 1
 #endif
 
+/**
+ *  RZDataBinding resolves the implementation of each callback action when the target is registered,
+ *  and calls that implementation directly when the observed key path changes.
+ *
+ *  If you swizzle or otherwise replace the implementation of a method that is already registered
+ *  as an RZDataBinding action, or of a getter or setter used by a key binding or an observed key path,
+ *  call this function afterwards so that the new implementation is used.
+ *  Changes to a target's class (e.g. by KVO) are detected automatically.
+ */
+OBJC_EXTERN void rz_invalidateCallbackCache(void);
+
+/**
+ *  Set this to 1 to collect statistics about the notifications sent by RZDataBinding, which can be read using RZDBInstrumentation.
+ *  Like RZDB_AUTOMATIC_CLEANUP, this must be defined the same way when compiling RZDataBinding and any code that uses it.
+ *  By default instrumentation is compiled out entirely, and has no cost.
+ *
+ *  @see RZDBInstrumentation
+ */
+#ifndef RZDB_INSTRUMENTATION
+#define RZDB_INSTRUMENTATION 0
+#endif
+
 #pragma mark - NSObject+RZDataBinding interface
 
 @interface NSObject (RZDataBinding)
@@ -120,6 +220,69 @@ OBJC_EXTERN NSString* const kRZDBChangeKeyKeyPath;
  */
 - (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChanges:(NSArray *)keyPaths callImmediately:(BOOL)callImmediately;
 
+/**
+ *  Register a selector to be called on a given target whenever keyPath changes on the receiver, with options that modify how the callback is sent.
+ *
+ *  @param target  The object on which to call the action selector. Must be non-nil. This object is not retained.
+ *  @param action  The selector to call on the target. Must not be NULL. See rz_addTarget documentation for more details.
+ *  @param keyPath The key path of the receiver for which changes should trigger an action. Must be KVC compliant.
+ *  @param options Options that modify how the action is called. See RZDBObservationOptions.
+ *
+ *  @see RZDB_KP macro for creating keypaths.
+ */
+- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChange:(NSString *)keyPath options:(RZDBObservationOptions)options;
+
+/**
+ *  Calls rz_addTarget:action:forKeyPathChange:options: for each keyPath in the keyPaths array.
+ *  The action's method signature is looked up, and the receiver and target are prepared for observation, only once for the whole array.
+ *
+ *  @param target   The object on which to call the action selector. Must be non-nil. This object is not retained.
+ *  @param action   The selector to call on the target. Must not be NULL. See rz_addTarget documentation for more details.
+ *  @param keyPaths An array of key paths that should trigger an action. Each key path must be KVC compliant.
+ *  @param options  Options that modify how the action is called. See RZDBObservationOptions. If RZDBObservationOptionCallImmediately is included and the action takes no arguments, it is called immediately only once.
+ *
+ *  @see RZDB_KP macro for creating keypaths.
+ */
+- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChanges:(NSArray *)keyPaths options:(RZDBObservationOptions)options;
+
+/**
+ *  Calls rz_addTarget:action:forKeyPathChanges:options:, but delivers callbacks asynchronously on the given queue.
+ *
+ *  Changes are collected until the queue next runs, and then delivered together in a single hop. If a key path changes
+ *  several times before delivery, the action is called only once for it, with the latest value for kRZDBChangeKeyNew
+ *  and the earliest value for kRZDBChangeKeyOld. Callbacks are delivered asynchronously even if the change is made on the queue.
+ *  Changes that are still pending when the target deallocates are dropped.
+ *
+ *  Only dispatch queues are supported as delivery targets. To deliver once per turn of the main run loop, use the main queue,
+ *  which the main run loop drains.
+ *
+ *  @param target   The object on which to call the action selector. Must be non-nil. This object is not retained.
+ *  @param action   The selector to call on the target. Must not be NULL. See rz_addTarget documentation for more details.
+ *  @param keyPaths An array of key paths that should trigger an action. Each key path must be KVC compliant.
+ *  @param options  Options that modify how the action is called. See RZDBObservationOptions. If RZDBObservationOptionCallImmediately is included, the immediate call is also made on the queue.
+ *  @param queue    The queue on which to call the action, e.g. the main queue for UI updates. If nil, actions are called synchronously.
+ *
+ *  @see RZDB_KP macro for creating keypaths.
+ */
+- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChanges:(NSArray *)keyPaths options:(RZDBObservationOptions)options queue:(dispatch_queue_t)queue;
+
+/**
+ *  Calls rz_addTarget:action:forKeyPathChanges:options:queue:, limiting how often the action is called
+ *  if the options include RZDBObservationOptionThrottle or RZDBObservationOptionDebounce.
+ *
+ *  Each key path is rate limited independently. Rate limited actions are always called asynchronously on the queue.
+ *
+ *  @param target   The object on which to call the action selector. Must be non-nil. This object is not retained.
+ *  @param action   The selector to call on the target. Must not be NULL. See rz_addTarget documentation for more details.
+ *  @param keyPaths An array of key paths that should trigger an action. Each key path must be KVC compliant.
+ *  @param options  Options that modify how the action is called. See RZDBObservationOptions.
+ *  @param interval The throttle or debounce interval, in seconds. Ignored unless the options include one of them.
+ *  @param queue    The queue on which to call the action. If nil, rate limited actions are called on the main queue, and other actions are called synchronously.
+ *
+ *  @see RZDB_KP macro for creating keypaths.
+ */
+- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChanges:(NSArray *)keyPaths options:(RZDBObservationOptions)options interval:(NSTimeInterval)interval queue:(dispatch_queue_t)queue;
+
 /**
  *  Removes previously registered target/action pairs so that the actions are no longer called when the receiver changes value for keyPath.
  *
@@ -163,7 +326,70 @@ OBJC_EXTERN NSString* const kRZDBChangeKeyKeyPath;
 - (void)rz_bindKey:(NSString *)key toKeyPath:(NSString *)foreignKeyPath ofObject:(id)object withTransform:(RZDBKeyBindingTransform)bindingTransform;
 
 /**
- *  Unbinds the given key of the receiver from the key path of another object.
+ *  Calls rz_bindKey:toKeyPath:ofObject:withTransform:, but sets the bound key asynchronously on the given queue when the key path changes.
+ *  Changes made before the queue next runs are batched, and the bound key is set only once, to the latest value.
+ *
+ *  @param key            The receiver's key whose value should be bound to the value of a foreign key path. Must be KVC compliant.
+ *  @param foreignKeyPath A key path of another object to which the receiver's key value should be bound. Must be KVC compliant.
+ *  @param object         An object with a key path that the receiver should bind to.
+ *  @param bindingTransform The transform to apply to changed values before setting the value of the bound key. May be nil.
+ *  @param queue          The queue on which to set the bound key. If nil, the key is set synchronously.
+ *
+ *  @note The receiver's value for the key is still set synchronously before this method returns.
+ *
+ *  @see RZDB_KP macro for creating keypaths, and RZDBTransforms for constant transforms.
+ */
+- (void)rz_bindKey:(NSString *)key toKeyPath:(NSString *)foreignKeyPath ofObject:(id)object withTransform:(RZDBKeyBindingTransform)bindingTransform queue:(dispatch_queue_t)queue;
+
+/**
+ *  Calls rz_bindKey:toKeyPath:ofObject:withTransform:queue:, limiting how often the bound key is set
+ *  if the options include RZDBObservationOptionThrottle or RZDBObservationOptionDebounce.
+ *  The bound key is always set to the latest value. If the options include RZDBObservationOptionOrdered,
+ *  the bound key is set in topological order with the other ordered bindings that a change affects.
+ *
+ *  @param key            The receiver's key whose value should be bound to the value of a foreign key path. Must be KVC compliant.
+ *  @param foreignKeyPath A key path of another object to which the receiver's key value should be bound. Must be KVC compliant.
+ *  @param object         An object with a key path that the receiver should bind to.
+ *  @param bindingTransform The transform to apply to changed values before setting the value of the bound key. May be nil.
+ *  @param options        RZDBObservationOptionThrottle, RZDBObservationOptionDebounce and/or RZDBObservationOptionOrdered. Other options don't apply to bindings.
+ *  @param interval       The throttle or debounce interval, in seconds.
+ *  @param queue          The queue on which to set the bound key. If nil, rate limited updates are made on the main queue.
+ *
+ *  @note The receiver's value for the key is still set synchronously before this method returns.
+ *
+ *  @see RZDB_KP macro for creating keypaths, and RZDBTransforms for constant transforms.
+ */
+- (void)rz_bindKey:(NSString *)key toKeyPath:(NSString *)foreignKeyPath ofObject:(id)object withTransform:(RZDBKeyBindingTransform)bindingTransform options:(RZDBObservationOptions)options interval:(NSTimeInterval)interval queue:(dispatch_queue_t)queue;
+
+/**
+ *  Binds several keys of the receiver to key paths of another object. Equivalent to calling rz_bindKey:toKeyPath:ofObject: for each pair,
+ *  but the receiver and object are prepared for observation only once, which is significantly faster when establishing many bindings.
+ *
+ *  @param keyPathsByKey A dictionary whose keys are keys of the receiver, and whose values are the key paths of object to bind them to. Must be KVC compliant.
+ *  @param object        An object with key paths that the receiver should bind to.
+ *
+ *  @see RZDB_KP macro for creating keypaths.
+ */
+- (void)rz_bindKeysToKeyPaths:(NSDictionary *)keyPathsByKey ofObject:(id)object;
+
+/**
+ *  Binds an ordered to-many key of the receiver to an array key path of another object. The receiver's key is first set to a mutable copy
+ *  of the foreign array. Afterwards, each insertion, removal or replacement in the foreign array is applied to only the affected indexes
+ *  of the receiver's array, using mutableArrayValueForKey:, so that observers of the receiver's key see the same fine grained changes.
+ *
+ *  @param key            The receiver's ordered to-many key. Must be KVC compliant for mutableArrayValueForKey:.
+ *  @param foreignKeyPath An array key path of another object. Changes should be made through mutableArrayValueForKey: or the indexed accessors,
+ *                        otherwise KVO reports them as setting the whole array, and the receiver's array is replaced.
+ *  @param object         An object with a key path that the receiver should bind to.
+ *
+ *  @note Use rz_unbindKey:fromKeyPath:ofObject: to remove the binding.
+ *
+ *  @see RZDB_KP macro for creating keypaths.
+ */
+- (void)rz_bindArrayKey:(NSString *)key toKeyPath:(NSString *)foreignKeyPath ofObject:(id)object;
+
+/**
+ *  Unbinds the given key of the receiver from the key path of another object. Also removes array bindings made with rz_bindArrayKey:toKeyPath:ofObject:.
  *
  *  @param key            The key to unbind.
  *  @param foreignKeyPath The key path that the key should be unbound from.
@@ -175,6 +401,35 @@ OBJC_EXTERN NSString* const kRZDBChangeKeyKeyPath;
  */
 - (void)rz_unbindKey:(NSString *)key fromKeyPath:(NSString *)foreignKeyPath ofObject:(id)object;
 
+/**
+ *  Suspends every callback and binding whose target is the receiver, without removing any observers or KVO registrations.
+ *  While suspended, nothing is delivered to the receiver, and only the latest change to each observed key path is recorded.
+ *  This is useful for offscreen view controllers and reusable views, which would otherwise have to unbind and rebind.
+ *
+ *  Every call MUST be balanced by a call to rz_resumeCallbacks. Suspensions may be nested.
+ */
+- (void)rz_suspendCallbacks;
+
+/**
+ *  Resumes callbacks and bindings suspended by rz_suspendCallbacks. When the outermost suspension is resumed,
+ *  each key path that changed while suspended is delivered once, with its latest new value and earliest old value.
+ */
+- (void)rz_resumeCallbacks;
+
+/**
+ *  Suspends delivery of changes to the receiver's key paths to all of their observers, i.e. the targets registered with
+ *  the rz_addTarget:action: methods and the objects bound with the rz_bindKey: methods. Otherwise behaves like rz_suspendCallbacks.
+ *
+ *  Every call MUST be balanced by a call to rz_resumeObservers. Suspensions may be nested.
+ */
+- (void)rz_suspendObservers;
+
+/**
+ *  Resumes delivery suspended by rz_suspendObservers. When the outermost suspension is resumed,
+ *  each key path that changed while suspended is delivered once, with its latest new value and earliest old value.
+ */
+- (void)rz_resumeObservers;
+
 #if !RZDB_AUTOMATIC_CLEANUP
 /**
  *  Removes all callbacks and bindings both to and from the receiver.
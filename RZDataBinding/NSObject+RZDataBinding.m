@@ -26,24 +26,50 @@
 // WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 //
 
+#import <math.h>
 #import <objc/runtime.h>
 #import <objc/message.h>
+#import <pthread.h>
+#import <stdatomic.h>
+
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+#import <CoreGraphics/CGGeometry.h>
+#define RZDB_CORE_GRAPHICS 1
+#else
+#define RZDB_CORE_GRAPHICS 0
+#endif
 
 #import "NSObject+RZDataBinding.h"
+#import "RZDBCoalesce.h"
+#import "RZDBKeyPath.h"
 #import "RZDBMacros.h"
 
+#if RZDB_INSTRUMENTATION
+#import "RZDBRecordFormat.h"
+#endif
+
 @class RZDBObserver;
+@class RZDBObserverExtras;
 @class RZDBObserverContainer;
+@class RZDBCallback;
+@class RZDBChange;
+@class RZDBTypedBinding;
+@class RZDBTransformPipeline;
+@class RZDBDeliveryBatch;
+@class RZDBRateLimiter;
+@class RZDBPropagation;
+@class RZDBSuspension;
+@class RZDBStatistics;
 
 // public change keys
 NSString* const kRZDBChangeKeyObject  = @"RZDBChangeObject";
 NSString* const kRZDBChangeKeyOld     = @"RZDBChangeOld";
 NSString* const kRZDBChangeKeyNew     = @"RZDBChangeNew";
 NSString* const kRZDBChangeKeyKeyPath = @"RZDBChangeKeyPath";
-
-// private change keys
-static NSString* const kRZDBChangeKeyBoundKey            = @"_RZDBChangeBoundKey";
-static NSString* const kRZDBChangeKeyBindingTransformKey = @"_RZDBChangeBindingTransform";
+NSString* const kRZDBChangeKeyKind    = @"RZDBChangeKind";
+NSString* const kRZDBChangeKeyIndexes = @"RZDBChangeIndexes";
+NSString* const kRZDBChangeKeyRemovedIndexes  = @"RZDBChangeRemovedIndexes";
+NSString* const kRZDBChangeKeyInsertedIndexes = @"RZDBChangeInsertedIndexes";
 
 static void* const kRZDBSwizzledDeallocKey = (void *)&kRZDBSwizzledDeallocKey;
 
@@ -51,6 +77,40 @@ static void* const kRZDBKVOContext = (void *)&kRZDBKVOContext;
 
 static void* const kRZDBRegisteredObserversKey = (void *)&kRZDBRegisteredObserversKey;
 static void* const kRZDBDependentObserversKey = (void *)&kRZDBDependentObserversKey;
+static void* const kRZDBMultiplexersKey = (void *)&kRZDBMultiplexersKey;
+static void* const kRZDBBindingRanksKey = (void *)&kRZDBBindingRanksKey;
+static void* const kRZDBTargetSuspensionKey = (void *)&kRZDBTargetSuspensionKey;
+static void* const kRZDBObjectSuspensionKey = (void *)&kRZDBObjectSuspensionKey;
+
+// incremented by rz_invalidateCallbackCache to force cached callback IMPs and compiled key paths to be resolved again
+atomic_uint_fast32_t kRZDBCallbackGeneration = 0;
+
+// the only options that affect the KVO change dictionary, and so the only options a multiplexer needs to union
+static const NSKeyValueObservingOptions kRZDBMultiplexedOptions = NSKeyValueObservingOptionNew | NSKeyValueObservingOptionOld;
+
+static const RZDBObservationOptions kRZDBRateLimitOptions = RZDBObservationOptionThrottle | RZDBObservationOptionDebounce;
+
+// the number of live observers registered with RZDBObservationOptionOrdered, so that changes are only tracked while there are any
+static atomic_uint_fast32_t kRZDBOrderedObserverCount = 0;
+
+// the number of live suspensions, so that changes are only checked against suspended objects while there are any
+static atomic_uint_fast32_t kRZDBSuspensionCount = 0;
+
+// ranks are capped so that a cycle of ordered bindings can't raise them forever
+static const NSUInteger kRZDBMaxBindingRank = 256;
+
+// dispatch objects are managed by ARC on Apple platforms, but must be retained manually elsewhere (e.g. GNUstep)
+#if OS_OBJECT_USE_OBJC
+#define RZDB_DISPATCH_OWNERSHIP strong
+#define rz_dispatchRetain(object)
+#define rz_dispatchRelease(object)
+#define rz_dispatchAddress(object) ((__bridge const void *)(object))
+#else
+#define RZDB_DISPATCH_OWNERSHIP assign
+#define rz_dispatchRetain(object) dispatch_retain(object)
+#define rz_dispatchRelease(object) dispatch_release(object)
+#define rz_dispatchAddress(object) ((const void *)(object))
+#endif
 
 #define RZDBNotNull(obj) ((obj) != nil && ![(obj) isEqual:[NSNull null]])
 
@@ -60,42 +120,349 @@ static void* const kRZDBDependentObserversKey = (void *)&kRZDBDependentObservers
 #define rz_dependentObservers(obj) objc_getAssociatedObject(obj, kRZDBDependentObserversKey)
 #define rz_setDependentObservers(obj, observers) objc_setAssociatedObject(obj, kRZDBDependentObserversKey, observers, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
 
+#define rz_multiplexers(obj) objc_getAssociatedObject(obj, kRZDBMultiplexersKey)
+#define rz_setMultiplexers(obj, multiplexers) objc_setAssociatedObject(obj, kRZDBMultiplexersKey, multiplexers, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+
+// bound key -> rank in the graph of ordered bindings, guarded by the object's lock stripe
+#define rz_bindingRanks(obj) objc_getAssociatedObject(obj, kRZDBBindingRanksKey)
+#define rz_setBindingRanks(obj, ranks) objc_setAssociatedObject(obj, kRZDBBindingRanksKey, ranks, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+
 #pragma mark - RZDataBinding_Private interface
 
+// RZDataBinding never uses @synchronized, so that its locking doesn't contend with the runtime's global sync table.
+// Objects that don't own a lock (e.g. user objects and classes) are locked using a lock stripe selected by address.
+void rz_lockObject(__unsafe_unretained id object);
+void rz_unlockObject(__unsafe_unretained id object);
+void rz_initRecursiveMutex(pthread_mutex_t *mutex);
+
+// returns the single immutable instance of the string, so that the many observers of a key path share its storage.
+// Interned strings are held weakly, so key paths built at runtime are freed once nothing observes them.
+NSString* rz_internString(NSString *string);
+
+// merges two successive change dicts for the same key path, as an RZDBCoalesce does
+NSDictionary* rz_mergeChangeDicts(NSDictionary *pendingChange, NSDictionary *change);
+
+// returns NO if no change is propagating on the current thread, in which case the callback should be sent immediately
+BOOL rz_deferPropagatingCallback(id target, SEL action, NSDictionary *change);
+
+// implemented in RZDBKeyPath.m
+OBJC_EXTERN void rz_invalidateKeyPathCache(void);
+
+#if RZDB_INSTRUMENTATION
+// implemented in RZDBInstrumentation.m
+OBJC_EXTERN RZDBStatistics* rz_statistics(Class objectClass, NSString *keyPath, Class targetClass);
+OBJC_EXTERN void rz_recordNotification(RZDBStatistics *statistics);
+
+// a monotonic time in nanoseconds
+OBJC_EXTERN uint64_t rz_instrumentationTime(void);
+OBJC_EXTERN void rz_recordCallbackLatency(RZDBStatistics *statistics, uint64_t nanoseconds);
+
+// the action is the bound key of a binding if there is one, and the selector otherwise
+OBJC_EXTERN RZDBRecordSite rz_recordSite(Class objectClass, NSString *keyPath, Class targetClass, SEL action, NSString *boundKey);
+
+OBJC_EXTERN BOOL rz_isRecording(void);
+
+// appends a record if recording. The duration is only meaningful with RZDB_RECORD_FLAG_DELIVERED, and the fanout with RZDB_RECORD_FLAG_CHANGE.
+OBJC_EXTERN void rz_appendRecord(RZDBRecordSite site, uint16_t flags, uint64_t timestamp, uint64_t duration, NSUInteger fanout);
+#endif
+
 // methods used to implement RZDB_AUTOMATIC_CLEANUP
 BOOL rz_requiresDeallocSwizzle(Class class);
 void rz_swizzleDeallocIfNeeded(Class class);
 
+BOOL rz_deallocSwizzleCacheContains(Class class);
+void rz_deallocSwizzleCacheInsert(Class class);
+
 @interface NSObject (RZDataBinding_Private)
 
-- (void)rz_addTarget:(id)target action:(SEL)action boundKey:(NSString *)boundKey bindingTransform:(RZDBKeyBindingTransform)bindingTransform forKeyPath:(NSString *)keyPath withOptions:(NSKeyValueObservingOptions)options;
+- (void)rz_bindKeys:(NSArray *)keys toKeyPaths:(NSArray *)foreignKeyPaths ofObject:(id)object withTransform:(RZDBKeyBindingTransform)bindingTransform options:(RZDBObservationOptions)options interval:(NSTimeInterval)interval queue:(dispatch_queue_t)queue;
+- (void)rz_registerObservers:(NSArray *)observers target:(id)target;
 - (void)rz_removeTarget:(id)target action:(SEL)action boundKey:(NSString *)boundKey forKeyPath:(NSString *)keyPath;
-- (void)rz_observeBoundKeyChange:(NSDictionary *)change;
 - (void)rz_setBoundKey:(NSString *)key withValue:(id)value transform:(RZDBKeyBindingTransform)transform;
+- (void)rz_setBoundArrayKey:(NSString *)key withKVOChange:(NSDictionary *)kvoChange;
+
+- (void)rz_attachObservers:(NSArray *)observers;
+- (void)rz_detachObserver:(RZDBObserver *)observer;
+- (void)rz_detachObservers:(NSArray *)observers;
+- (void)rz_invalidateMultiplexers;
+
+// must be called with the receiver's lock stripe held
+- (RZDBMultiplexer *)rz_multiplexerForKeyPath:(NSString *)keyPath inMultiplexers:(NSMutableDictionary *)multiplexers;
+- (void)rz_releaseMultiplexer:(RZDBMultiplexer *)multiplexer fromMultiplexers:(NSMutableDictionary *)multiplexers updated:(NSMutableArray *)updatedMultiplexers;
+
+@end
+
+// implemented in RZDBCoalesce.m
+@interface RZDBCoalesce (RZDataBinding_Private)
+
+// returns NO if no coalesce is in progress on the current thread, in which case the callback should be sent immediately
++ (BOOL)rz_coalesceTarget:(id)target action:(SEL)action change:(NSDictionary *)change;
+
+// a coalesce that is never made current on any thread, so that only callbacks added to it directly are deferred
++ (instancetype)rz_detachedCoalesce;
+
+- (void)rz_deferTarget:(id)target action:(SEL)action change:(NSDictionary *)change;
+
+// sends the pending callbacks, in the order they were first deferred, and empties the coalesce. Returns NO if there were none.
+- (BOOL)rz_sendNotifications;
+
+- (BOOL)rz_hasNotifications;
+
+@end
+
+// implemented in RZDBTransforms.m
+@interface RZDBTransformPipeline : NSObject
+
++ (instancetype)pipelineForTransform:(RZDBKeyBindingTransform)transform;
+
+// the type encoding of the values the pipeline transforms without boxing, or NULL if it has stages of more than one type
+@property (assign, nonatomic, readonly) const char *valueEncoding;
+
+- (double)transformDouble:(double)value;
+- (BOOL)transformBool:(BOOL)value;
+#if RZDB_CORE_GRAPHICS
+- (CGRect)transformRect:(CGRect)value;
+#endif
 
 @end
 
 #pragma mark - RZDBObserver interface
 
+// There can be hundreds of thousands of live observers, so the record is kept small: key paths are interned,
+// options are packed, the target and action are read from the callback, and rarely used state lives in an RZDBObserverExtras.
 @interface RZDBObserver : NSObject;
 
 @property (assign, nonatomic) __unsafe_unretained NSObject *observedObject;
 @property (copy, nonatomic) NSString *keyPath;
 @property (copy, nonatomic) NSString *boundKey;
 @property (assign, nonatomic) NSKeyValueObservingOptions observationOptions;
+@property (assign, nonatomic) RZDBObservationOptions callbackOptions;
 
-@property (assign, nonatomic) __unsafe_unretained id target;
-@property (assign, nonatomic) SEL action;
-@property (strong, nonatomic) NSMethodSignature *methodSignature;
+// nil once the observer is invalidated
+@property (assign, nonatomic, readonly) __unsafe_unretained id target;
+@property (assign, nonatomic, readonly) SEL action;
+
+// immutable and swapped atomically, so the notification path reads it without taking a lock
+@property (strong, atomic) RZDBCallback *callback;
 
 @property (copy, nonatomic) RZDBKeyBindingTransform bindingTransform;
 
+// if non-nil, the binding is applied directly between the two objects' accessors instead of through KVC
+@property (strong, nonatomic) RZDBTypedBinding *typedBinding;
+
+// if non-nil, changes are batched and delivered asynchronously on this queue
+@property (RZDB_DISPATCH_OWNERSHIP, nonatomic) dispatch_queue_t deliveryQueue;
+
+// if non-nil, changes are throttled or debounced, and delivered by the rate limiter
+@property (strong, nonatomic) RZDBRateLimiter *rateLimiter;
+
+#if RZDB_INSTRUMENTATION
+// shared by all observers with the same observed class, key path and target class
+@property (strong, nonatomic) RZDBStatistics *statistics;
+
+@property (assign, nonatomic) RZDBRecordSite recordSite;
+#endif
+
 - (instancetype)initWithObservedObject:(NSObject *)observedObject keyPath:(NSString *)keyPath observationOptions:(NSKeyValueObservingOptions)observingOptions;
 
-- (void)setTarget:(id)target action:(SEL)action boundKey:(NSString *)boundKey bindingTransform:(RZDBKeyBindingTransform)bindingTransform;
+- (void)setCallback:(RZDBCallback *)callback boundKey:(NSString *)boundKey bindingTransform:(RZDBKeyBindingTransform)bindingTransform;
+
+- (NSDictionary *)initialKVOChange;
+
+// sends the callback, or defers it if the observer is rate limited or has a delivery queue. Returns the change dictionary used, if any.
+- (RZDBChange *)notifyWithKVOChange:(NSDictionary *)kvoChange sharedChange:(RZDBChange *)change;
+
+// sends the callback, creating the change dictionary if needed and none was shared. Returns the change dictionary used.
+- (RZDBChange *)deliverKVOChange:(NSDictionary *)kvoChange sharedChange:(RZDBChange *)change;
+
+// sends the callback after an asynchronous hop, during which the target may have deallocated. The caller holds the target
+// weakly until then, and passes it in strongly so that it stays alive while the callback is sent. Does nothing if it is nil.
+- (void)deliverDeferredKVOChange:(NSDictionary *)kvoChange target:(id)target;
+
+// sets the bound key from the current value of the key path, rather than from a KVO change that may predate other ordered bindings
+- (void)applyCurrentValue;
+
+// a copy of the observed collection after a to-many change, which is needed to merge it with other pending changes. nil for other changes.
+- (id)collectionForKVOChange:(NSDictionary *)kvoChange;
+
+- (void)invalidate;
+
+// releases the observer's callback and rate limiter. -invalidate calls this after detaching the observer,
+// and a bulk teardown calls it directly once it has detached many observers at a time.
+- (void)clear;
+
+@end
+
+#pragma mark - RZDBObserverExtras interface
+
+// The state that only bindings with a transform, queue delivery, rate limiting or instrumentation need.
+// Allocated the first time any of it is set, so that plain observers don't carry it.
+@interface RZDBObserverExtras : NSObject
+
+@property (copy, nonatomic) RZDBKeyBindingTransform bindingTransform;
+@property (RZDB_DISPATCH_OWNERSHIP, nonatomic) dispatch_queue_t deliveryQueue;
+@property (strong, nonatomic) RZDBRateLimiter *rateLimiter;
+
+#if RZDB_INSTRUMENTATION
+@property (strong, nonatomic) RZDBStatistics *statistics;
+@property (assign, nonatomic) RZDBRecordSite recordSite;
+#endif
+
+@end
+
+#pragma mark - RZDBChange interface
+
+// An immutable change dictionary that answers the kRZDBChangeKeys from its fields,
+// and only builds a real backing dictionary if it is enumerated.
+@interface RZDBChange : NSDictionary
+
+- (instancetype)initWithObject:(id)object keyPath:(NSString *)keyPath kvoChange:(NSDictionary *)kvoChange;
+
+@end
+
+#pragma mark - RZDBTypedBinding interface
+
+// Binds a key of one object directly to a same-typed key of another, using the accessor IMPs
+// rather than KVC, so that scalar and struct values are never boxed.
+@interface RZDBTypedBinding : NSObject
+
+// returns nil if the keys aren't properties of the same supported type, or if the transform (which may be nil)
+// doesn't transform values of that type without boxing them
++ (instancetype)bindingFromKeyPath:(NSString *)keyPath ofObject:(id)object toKey:(NSString *)key ofObject:(id)target transform:(RZDBTransformPipeline *)transform;
+
+// caches the accessor IMPs for the current classes of the objects. Must be called at most once, after KVO registration.
+- (void)resolveForObject:(id)object target:(id)target;
+
+- (void)applyFromObject:(id)object toObject:(id)target;
+
+@end
+
+#pragma mark - RZDBCallback interface
+
+// An immutable dispatch record for a target/action pair, resolved once at registration.
+@interface RZDBCallback : NSObject
+
+@property (assign, nonatomic, readonly) __unsafe_unretained id target;
+@property (assign, nonatomic, readonly) SEL action;
+
+@property (assign, nonatomic, readonly) IMP implementation;
+@property (assign, nonatomic, readonly) BOOL passesChange;
+
++ (instancetype)callbackWithTarget:(id)target action:(SEL)action;
+
+// NO if the target has since changed class (e.g. isa-swizzled by KVO), or the cache was invalidated
+- (BOOL)isValid;
+
+@end
+
+#pragma mark - RZDBMultiplexer interface
+
+// Owns the single KVO registration for an (observed object, key path) pair,
+// and fans out each KVO notification to every RZDBObserver of that key path.
+//
+// The multiplexers of an object form a trie of its observed key paths. The multiplexer of a key path with several keys
+// only observes its last key, on the object that its parent's key path currently leads to. A shared prefix is therefore
+// observed once, and re-pointing an intermediate object re-subscribes each child of its multiplexer once, rather than
+// once per key path below it.
+//
+// The trie's structure (each multiplexer's observers and children) is guarded by the observed object's lock stripe.
+// Stripes are shared by unrelated objects, so nothing that calls out (getters or KVO registration) happens while one is held.
+// Instead, each multiplexer guards the object it observes with its own lock, and reconciles its KVO registration with the
+// structure once the stripe has been released. Multiplexer locks are taken parent before child, and a stripe may be taken
+// while holding one, but never the other way around.
+@interface RZDBMultiplexer : NSObject
+
+@property (assign, nonatomic, readonly) __unsafe_unretained NSObject *observedObject;
+@property (copy, nonatomic, readonly) NSString *keyPath;
+
+// the multiplexer of the key path without its last key, or nil if the key path has a single key
+@property (weak, nonatomic, readonly) RZDBMultiplexer *parent;
+
+@property (assign, nonatomic, readonly) NSKeyValueObservingOptions observationOptions;
+
+// an immutable snapshot of the observers, which is only copied again after the observers change
+@property (copy, nonatomic, readonly) NSArray *observers;
+
+// these must be called with the observed object's lock stripe held, and only change the trie's structure.
+// Call -resolve or -updateRegistration on the affected multiplexers once the stripe has been released.
+- (instancetype)initWithObservedObject:(NSObject *)observedObject keyPath:(NSString *)keyPath parent:(RZDBMultiplexer *)parent;
+
+- (void)addObserver:(RZDBObserver *)observer;
+- (void)removeObserver:(RZDBObserver *)observer;
+- (void)removeObservers:(NSArray *)observers;
+
+// NO once the multiplexer has neither observers nor children, at which point it should be invalidated
+- (BOOL)isInUse;
 
 - (void)invalidate;
 
+// these must be called without the observed object's lock stripe held.
+// -resolve attaches a new multiplexer and its ancestors to the objects their key paths lead to, and then updates its registration.
+- (void)resolve;
+
+// registers, re-registers or unregisters for KVO as the observers and children require
+- (void)updateRegistration;
+
+@end
+
+#pragma mark - RZDBDeliveryBatch interface
+
+// The changes pending delivery on a dispatch queue. Every change made before the queue next runs
+// is delivered in a single hop, and only the latest change for each observer is delivered.
+@interface RZDBDeliveryBatch : NSObject
+
++ (void)enqueueKVOChange:(NSDictionary *)kvoChange forObserver:(RZDBObserver *)observer;
+
+@end
+
+#pragma mark - RZDBRateLimiter interface
+
+// Throttles or debounces the changes of a single observer using a timer source,
+// and delivers them on a queue with the latest new value and the earliest old value.
+@interface RZDBRateLimiter : NSObject
+
+- (instancetype)initWithObserver:(RZDBObserver *)observer interval:(NSTimeInterval)interval debounce:(BOOL)debounce queue:(dispatch_queue_t)queue;
+
+- (void)addKVOChange:(NSDictionary *)kvoChange;
+
+- (void)cancel;
+
+@end
+
+#pragma mark - RZDBPropagation interface
+
+// The ordered bindings and callbacks pending on a thread while a change fans out. Once the outermost change has been fanned out,
+// bindings are set in order of the rank of their bound key in the binding graph, and then the deferred callbacks are sent.
+@interface RZDBPropagation : NSObject
+
+// called around each KVO fan out while there are ordered observers. The outermost commit drains the propagation.
++ (void)begin;
++ (void)commit;
+
+// called instead of +commit if the fan out raises. The outermost abort discards the pending work.
++ (void)abort;
+
+// returns NO if no change is propagating on the current thread, in which case the binding should be set immediately
++ (BOOL)enqueueBindingObserver:(RZDBObserver *)observer;
+
+// returns NO if no change is propagating on the current thread, in which case the callback should be sent immediately
++ (BOOL)deferTarget:(id)target action:(SEL)action change:(NSDictionary *)change;
+
+@end
+
+#pragma mark - RZDBSuspension interface
+
+// The changes held for a suspended target or observed object. Only the latest change for each observer is kept,
+// and the changes are delivered in the order they first occurred when the object resumes.
+@interface RZDBSuspension : NSObject
+
+// key is kRZDBTargetSuspensionKey or kRZDBObjectSuspensionKey. Calls must be balanced.
++ (void)suspendObject:(id)object key:(const void *)key;
++ (void)resumeObject:(id)object key:(const void *)key;
+
+// returns NO if neither the observer's target nor its observed object is suspended, in which case the change should be delivered
++ (BOOL)suspendKVOChange:(NSDictionary *)kvoChange forObserver:(RZDBObserver *)observer;
+
 @end
 
 #pragma mark - RZDBObserverContainer interface
@@ -106,371 +473,3193 @@ void rz_swizzleDeallocIfNeeded(Class class);
 + (instancetype)weakContainer;
 
 - (void)addObserver:(RZDBObserver *)observer;
+- (void)addObservers:(NSArray *)observers;
 - (void)removeObserver:(RZDBObserver *)observer;
+- (void)removeObservers:(NSArray *)observers;
+
+- (NSArray *)observersForKeyPath:(NSString *)keyPath target:(id)target;
+- (NSArray *)observersForKeyPath:(NSString *)keyPath;
+
+// empties the container under a single lock, and returns the observers it held
+- (NSArray *)removeAllObservers;
+
+@end
+
+#pragma mark - RZDataBinding implementation
+
+@implementation NSObject (RZDataBinding)
+
+- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChange:(NSString *)keyPath
+{
+    [self rz_addTarget:target action:action forKeyPathChange:keyPath callImmediately:NO];
+}
+
+- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChange:(NSString *)keyPath callImmediately:(BOOL)callImmediately
+{
+    [self rz_addTarget:target action:action forKeyPathChange:keyPath options:(callImmediately ? RZDBObservationOptionCallImmediately : RZDBObservationOptionNone)];
+}
+
+- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChanges:(NSArray *)keyPaths
+{
+    [self rz_addTarget:target action:action forKeyPathChanges:keyPaths callImmediately:NO];
+}
+
+- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChanges:(NSArray *)keyPaths callImmediately:(BOOL)callImmediately
+{
+    [self rz_addTarget:target action:action forKeyPathChanges:keyPaths options:(callImmediately ? RZDBObservationOptionCallImmediately : RZDBObservationOptionNone)];
+}
+
+- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChange:(NSString *)keyPath options:(RZDBObservationOptions)options
+{
+    NSParameterAssert(keyPath);
+
+    [self rz_addTarget:target action:action forKeyPathChanges:@[keyPath] options:options];
+}
+
+- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChanges:(NSArray *)keyPaths options:(RZDBObservationOptions)options
+{
+    [self rz_addTarget:target action:action forKeyPathChanges:keyPaths options:options queue:nil];
+}
+
+- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChanges:(NSArray *)keyPaths options:(RZDBObservationOptions)options queue:(dispatch_queue_t)queue
+{
+    [self rz_addTarget:target action:action forKeyPathChanges:keyPaths options:options interval:0.0 queue:queue];
+}
+
+- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChanges:(NSArray *)keyPaths options:(RZDBObservationOptions)options interval:(NSTimeInterval)interval queue:(dispatch_queue_t)queue
+{
+    NSParameterAssert(target);
+    NSParameterAssert(action);
+    NSParameterAssert(!(options & kRZDBRateLimitOptions) || interval > 0.0);
+
+    // the callback is resolved once, and shared by the observers of every key path
+    RZDBCallback *callback = [RZDBCallback callbackWithTarget:target action:action];
+
+    BOOL callImmediately = (options & RZDBObservationOptionCallImmediately) != 0;
+    NSKeyValueObservingOptions observationOptions = kNilOptions;
+
+    if ( callback.passesChange ) {
+        observationOptions |= NSKeyValueObservingOptionNew | NSKeyValueObservingOptionOld;
+
+        // an action with a change dict parameter is called immediately once for each key path
+        if ( callImmediately ) {
+            observationOptions |= NSKeyValueObservingOptionInitial;
+        }
+    }
+
+    NSMutableArray *observers = [NSMutableArray arrayWithCapacity:keyPaths.count];
+
+    for ( NSString *keyPath in keyPaths ) {
+        RZDBObserver *observer = [[RZDBObserver alloc] initWithObservedObject:self keyPath:keyPath observationOptions:observationOptions];
+        observer.callbackOptions = options;
+        observer.deliveryQueue = queue;
+
+        if ( options & kRZDBRateLimitOptions ) {
+            observer.rateLimiter = [[RZDBRateLimiter alloc] initWithObserver:observer interval:interval debounce:(options & RZDBObservationOptionDebounce) != 0 queue:queue];
+        }
+
+        [observer setCallback:callback boundKey:nil bindingTransform:nil];
+        [observers addObject:observer];
+    }
+
+    [self rz_registerObservers:observers target:target];
+
+    // an action without parameters is called immediately only once, through the first observer so that options are respected
+    if ( callImmediately && !callback.passesChange ) {
+        RZDBObserver *observer = observers.firstObject;
+
+        [observer notifyWithKVOChange:[observer initialKVOChange] sharedChange:nil];
+    }
+}
+
+- (void)rz_removeTarget:(id)target action:(SEL)action forKeyPathChange:(NSString *)keyPath
+{
+    [self rz_removeTarget:target action:action boundKey:nil forKeyPath:keyPath];
+}
+
+- (void)rz_bindKey:(NSString *)key toKeyPath:(NSString *)foreignKeyPath ofObject:(id)object
+{
+    [self rz_bindKey:key toKeyPath:foreignKeyPath ofObject:object withTransform:nil];
+}
 
-- (void)enumerateObserversUsingBlock:(void (^)(RZDBObserver *observer, BOOL *stop))block;
+- (void)rz_bindKey:(NSString *)key toKeyPath:(NSString *)foreignKeyPath ofObject:(id)object withTransform:(RZDBKeyBindingTransform)bindingTransform
+{
+    [self rz_bindKey:key toKeyPath:foreignKeyPath ofObject:object withTransform:bindingTransform queue:nil];
+}
+
+- (void)rz_bindKey:(NSString *)key toKeyPath:(NSString *)foreignKeyPath ofObject:(id)object withTransform:(RZDBKeyBindingTransform)bindingTransform queue:(dispatch_queue_t)queue
+{
+    [self rz_bindKey:key toKeyPath:foreignKeyPath ofObject:object withTransform:bindingTransform options:RZDBObservationOptionNone interval:0.0 queue:queue];
+}
+
+- (void)rz_bindKey:(NSString *)key toKeyPath:(NSString *)foreignKeyPath ofObject:(id)object withTransform:(RZDBKeyBindingTransform)bindingTransform options:(RZDBObservationOptions)options interval:(NSTimeInterval)interval queue:(dispatch_queue_t)queue
+{
+    NSParameterAssert(key);
+    NSParameterAssert(foreignKeyPath);
+    NSParameterAssert(!(options & kRZDBRateLimitOptions) || interval > 0.0);
+
+    [self rz_bindKeys:@[key] toKeyPaths:@[foreignKeyPath] ofObject:object withTransform:bindingTransform options:options interval:interval queue:queue];
+}
+
+- (void)rz_bindKeysToKeyPaths:(NSDictionary *)keyPathsByKey ofObject:(id)object
+{
+    NSArray *keys = keyPathsByKey.allKeys;
+
+    [self rz_bindKeys:keys toKeyPaths:[keyPathsByKey objectsForKeys:keys notFoundMarker:[NSNull null]] ofObject:object withTransform:nil options:RZDBObservationOptionNone interval:0.0 queue:nil];
+}
+
+- (void)rz_bindArrayKey:(NSString *)key toKeyPath:(NSString *)foreignKeyPath ofObject:(id)object
+{
+    NSParameterAssert(key);
+    NSParameterAssert(foreignKeyPath);
+
+    if ( object == nil ) {
+        return;
+    }
+
+    @try {
+        NSArray *array = [[RZDBKeyPath keyPathWithString:foreignKeyPath forClass:object_getClass(object)] valueForObject:object];
+
+        // later changes are applied in place, so the receiver's array must be mutable
+        [self setValue:[array mutableCopy] forKey:key];
+    }
+    @catch (NSException *exception) {
+        [NSException raise:NSInvalidArgumentException format:@"RZDataBinding cannot bind array key:%@ to key path:%@ of object:%@. Reason: %@", key, foreignKeyPath, [object description], exception.reason];
+    }
+
+    RZDBCallback *callback = [RZDBCallback callbackWithTarget:self action:@selector(rz_setBoundArrayKey:withKVOChange:)];
+
+    RZDBObserver *observer = [[RZDBObserver alloc] initWithObservedObject:object keyPath:foreignKeyPath observationOptions:NSKeyValueObservingOptionNew];
+    [observer setCallback:callback boundKey:key bindingTransform:nil];
+
+    [object rz_registerObservers:@[observer] target:self];
+}
+
+- (void)rz_unbindKey:(NSString *)key fromKeyPath:(NSString *)foreignKeyPath ofObject:(id)object
+{
+    // only bindings have a bound key, so this removes both value and array bindings of the key
+    [object rz_removeTarget:self action:NULL boundKey:key forKeyPath:foreignKeyPath];
+}
+
+- (void)rz_suspendCallbacks
+{
+    [RZDBSuspension suspendObject:self key:kRZDBTargetSuspensionKey];
+}
+
+- (void)rz_resumeCallbacks
+{
+    [RZDBSuspension resumeObject:self key:kRZDBTargetSuspensionKey];
+}
+
+- (void)rz_suspendObservers
+{
+    [RZDBSuspension suspendObject:self key:kRZDBObjectSuspensionKey];
+}
+
+- (void)rz_resumeObservers
+{
+    [RZDBSuspension resumeObject:self key:kRZDBObjectSuspensionKey];
+}
+
+@end
+
+#pragma mark - Bulk teardown
+
+// groups observers by the object returned for each, skipping observers for which it is nil (i.e. already invalidated).
+// Groups are keyed by address, so the grouping objects are neither retained nor messaged.
+static NSMapTable* rz_groupObservers(NSArray *observers, id (^groupKey)(RZDBObserver *observer))
+{
+    NSMapTable *groups = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality
+                                               valueOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPersonality];
+
+    for ( RZDBObserver *observer in observers ) {
+        id key = groupKey(observer);
+
+        if ( key != nil ) {
+            NSMutableArray *group = [groups objectForKey:key];
+
+            if ( group == nil ) {
+                group = [NSMutableArray array];
+                [groups setObject:group forKey:key];
+            }
+
+            [group addObject:observer];
+        }
+    }
+
+    return groups;
+}
+
+#pragma mark - Key path trie
+
+// the key path without its last key, or nil if it has a single key. Key paths with collection operators
+// can't be observed a key at a time, so they are observed whole.
+static NSString* rz_parentKeyPath(NSString *keyPath)
+{
+    NSRange lastDot = [keyPath rangeOfString:@"." options:NSBackwardsSearch];
+
+    if ( lastDot.location == NSNotFound || [keyPath rangeOfString:@"@"].location != NSNotFound ) {
+        return nil;
+    }
+
+    return [keyPath substringToIndex:lastDot.location];
+}
+
+#pragma mark - Binding graph
+
+// the rank of a key of an object in the graph of ordered bindings. Keys that aren't bound by ordered bindings have rank 0.
+static NSUInteger rz_bindingRank(id object, NSString *key)
+{
+    rz_lockObject(object);
+    NSUInteger rank = [rz_bindingRanks(object)[key] unsignedIntegerValue];
+    rz_unlockObject(object);
+
+    return rank;
+}
+
+// raises the rank of a bound key to at least the given rank, and the ranks of the ordered bindings that depend on it to match
+static void rz_raiseBindingRank(id object, NSString *key, NSUInteger rank)
+{
+    if ( rank > kRZDBMaxBindingRank ) {
+        RZDBLog(@"RZDataBinding found a cycle of ordered bindings through key:%@ of object:%@. The bindings in the cycle will not be ordered.", key, object);
+        return;
+    }
+
+    rz_lockObject(object);
+
+    NSMutableDictionary *ranks = rz_bindingRanks(object);
+
+    if ( ranks == nil ) {
+        ranks = [NSMutableDictionary dictionary];
+        rz_setBindingRanks(object, ranks);
+    }
+
+    BOOL raised = (rank > [ranks[key] unsignedIntegerValue]);
+
+    if ( raised ) {
+        ranks[key] = @(rank);
+    }
+
+    rz_unlockObject(object);
+
+    if ( raised ) {
+        for ( RZDBObserver *observer in [rz_registeredObservers(object) observersForKeyPath:key] ) {
+            id target = observer.target;
+
+            if ( target != nil && observer.boundKey != nil && (observer.callbackOptions & RZDBObservationOptionOrdered) ) {
+                rz_raiseBindingRank(target, observer.boundKey, rank + 1);
+            }
+        }
+    }
+}
+
+#pragma mark - RZDataBinding_Private implementation
+
+@implementation NSObject (RZDataBinding_Private)
+
+- (void)rz_bindKeys:(NSArray *)keys toKeyPaths:(NSArray *)foreignKeyPaths ofObject:(id)object withTransform:(RZDBKeyBindingTransform)bindingTransform options:(RZDBObservationOptions)options interval:(NSTimeInterval)interval queue:(dispatch_queue_t)queue
+{
+    if ( object == nil ) {
+        return;
+    }
+
+    // every binding of the receiver shares the same callback
+    RZDBCallback *callback = [RZDBCallback callbackWithTarget:self action:@selector(rz_setBoundKey:withValue:transform:)];
+    NSMutableArray *observers = [NSMutableArray arrayWithCapacity:keys.count];
+
+    // a transform can be applied by a typed binding if it passes values unboxed from start to end
+    RZDBTransformPipeline *transformPipeline = [RZDBTransformPipeline pipelineForTransform:bindingTransform];
+
+    [keys enumerateObjectsUsingBlock:^(NSString *key, NSUInteger idx, BOOL *stop) {
+        NSString *foreignKeyPath = foreignKeyPaths[idx];
+
+        // a typed binding reads the new value itself, so KVO doesn't need to provide (and box) it.
+        // An asynchronous binding must capture the value when it changes, so it can't read it later on the delivery queue.
+        BOOL typed = ((bindingTransform == nil || transformPipeline.valueEncoding != NULL) && queue == nil && !(options & kRZDBRateLimitOptions));
+        RZDBTypedBinding *typedBinding = typed ? [RZDBTypedBinding bindingFromKeyPath:foreignKeyPath ofObject:object toKey:key ofObject:self transform:transformPipeline] : nil;
+
+        @try {
+            if ( typedBinding != nil ) {
+                [typedBinding applyFromObject:object toObject:self];
+            }
+            else {
+                id val = [[RZDBKeyPath keyPathWithString:foreignKeyPath forClass:object_getClass(object)] valueForObject:object];
+
+                [self rz_setBoundKey:key withValue:val transform:bindingTransform];
+            }
+        }
+        @catch (NSException *exception) {
+            [NSException raise:NSInvalidArgumentException format:@"RZDataBinding cannot bind key:%@ to key path:%@ of object:%@. Reason: %@", key, foreignKeyPath, [object description], exception.reason];
+        }
+
+        RZDBObserver *observer = [[RZDBObserver alloc] initWithObservedObject:object keyPath:foreignKeyPath observationOptions:(typedBinding != nil) ? kNilOptions : NSKeyValueObservingOptionNew];
+        observer.callbackOptions = options;
+        observer.typedBinding = typedBinding;
+        observer.deliveryQueue = queue;
+
+        if ( options & kRZDBRateLimitOptions ) {
+            observer.rateLimiter = [[RZDBRateLimiter alloc] initWithObserver:observer interval:interval debounce:(options & RZDBObservationOptionDebounce) != 0 queue:queue];
+        }
+
+        [observer setCallback:callback boundKey:key bindingTransform:bindingTransform];
+        [observers addObject:observer];
+    }];
+
+    [object rz_registerObservers:observers target:self];
+
+    // observing the object changes its class, so the accessors are resolved only after registration
+    for ( RZDBObserver *observer in observers ) {
+        [observer.typedBinding resolveForObject:object target:self];
+    }
+
+    // record the binding graph, so that a propagating change sets each bound key after the ordered bindings it depends on
+    if ( options & RZDBObservationOptionOrdered ) {
+        [keys enumerateObjectsUsingBlock:^(NSString *key, NSUInteger idx, BOOL *stop) {
+            rz_raiseBindingRank(self, key, rz_bindingRank(object, foreignKeyPaths[idx]) + 1);
+        }];
+    }
+}
+
+- (void)rz_registerObservers:(NSArray *)observers target:(id)target
+{
+    RZDBObserverContainer *registeredObservers = nil;
+    RZDBObserverContainer *dependentObservers = nil;
+
+    rz_lockObject(self);
+
+    registeredObservers = rz_registeredObservers(self);
+
+    if ( registeredObservers == nil ) {
+        registeredObservers = [RZDBObserverContainer strongContainer];
+        rz_setRegisteredObservers(self, registeredObservers);
+    }
+
+    rz_unlockObject(self);
+
+    [registeredObservers addObservers:observers];
+
+    rz_lockObject(target);
+
+    dependentObservers = rz_dependentObservers(target);
+
+    if ( dependentObservers == nil ) {
+        dependentObservers = [RZDBObserverContainer weakContainer];
+        rz_setDependentObservers(target, dependentObservers);
+    }
+
+    rz_unlockObject(target);
+
+    [dependentObservers addObservers:observers];
+
+    // balanced in -[RZDBObserver clear]
+    for ( RZDBObserver *observer in observers ) {
+        if ( observer.callbackOptions & RZDBObservationOptionOrdered ) {
+            atomic_fetch_add_explicit(&kRZDBOrderedObserverCount, 1, memory_order_relaxed);
+        }
+    }
+
+#if RZDB_INSTRUMENTATION
+    for ( RZDBObserver *observer in observers ) {
+        observer.statistics = rz_statistics([self class], observer.keyPath, [target class]);
+        observer.recordSite = rz_recordSite([self class], observer.keyPath, [target class], observer.action, observer.boundKey);
+    }
+#endif
+
+    [self rz_attachObservers:observers];
+
+    // the KVO registration is shared, so initial callbacks are sent to the new observers only
+    for ( RZDBObserver *observer in observers ) {
+        if ( observer.observationOptions & NSKeyValueObservingOptionInitial ) {
+            [observer notifyWithKVOChange:[observer initialKVOChange] sharedChange:nil];
+        }
+    }
+
+#if RZDB_AUTOMATIC_CLEANUP
+    rz_swizzleDeallocIfNeeded([self class]);
+    rz_swizzleDeallocIfNeeded([target class]);
+#endif
+}
+
+- (void)rz_removeTarget:(id)target action:(SEL)action boundKey:(NSString *)boundKey forKeyPath:(NSString *)keyPath
+{
+    // the container is indexed by key path and target, so only those observers need to be checked
+    NSArray *observers = [rz_registeredObservers(self) observersForKeyPath:keyPath target:target];
+
+    for ( RZDBObserver *observer in observers ) {
+        BOOL actionsEqual   = (action == NULL || action == observer.action);
+        BOOL boundKeysEqual = (boundKey == observer.boundKey || [boundKey isEqualToString:observer.boundKey]);
+
+        if ( actionsEqual && boundKeysEqual ) {
+            [observer invalidate];
+        }
+    }
+}
+
+- (void)rz_setBoundKey:(NSString *)key withValue:(id)value transform:(RZDBKeyBindingTransform)transform
+{
+    id currentValue = [[RZDBKeyPath keyPathWithString:key forClass:object_getClass(self)] valueForObject:self];
+
+    if ( transform != nil ) {
+        value = transform(value);
+    }
+
+    if ( currentValue != value && ![currentValue isEqual:value] ) {
+        [self setValue:value forKey:key];
+    }
+}
+
+- (void)rz_setBoundArrayKey:(NSString *)key withKVOChange:(NSDictionary *)kvoChange
+{
+    NSKeyValueChange kind = [kvoChange[NSKeyValueChangeKindKey] unsignedIntegerValue];
+    NSIndexSet *indexes = kvoChange[NSKeyValueChangeIndexesKey];
+
+    id value = kvoChange[NSKeyValueChangeNewKey];
+    value = RZDBNotNull(value) ? value : nil;
+
+    switch ( kind ) {
+        case NSKeyValueChangeInsertion:
+            [[self mutableArrayValueForKey:key] insertObjects:value atIndexes:indexes];
+            break;
+
+        case NSKeyValueChangeRemoval:
+            [[self mutableArrayValueForKey:key] removeObjectsAtIndexes:indexes];
+            break;
+
+        case NSKeyValueChangeReplacement:
+            [[self mutableArrayValueForKey:key] replaceObjectsAtIndexes:indexes withObjects:value];
+            break;
+
+        default:
+            [self setValue:[value mutableCopy] forKey:key];
+            break;
+    }
+}
+
+- (void)rz_attachObservers:(NSArray *)observers
+{
+    // the multiplexers of an object are guarded by the object's lock stripe
+    rz_lockObject(self);
+
+    NSMutableDictionary *multiplexers = rz_multiplexers(self);
+
+    if ( multiplexers == nil ) {
+        multiplexers = [NSMutableDictionary dictionary];
+        rz_setMultiplexers(self, multiplexers);
+    }
+
+    NSMutableArray *attachedMultiplexers = [NSMutableArray array];
+
+    for ( RZDBObserver *observer in observers ) {
+        RZDBMultiplexer *multiplexer = [self rz_multiplexerForKeyPath:observer.keyPath inMultiplexers:multiplexers];
+
+        [multiplexer addObserver:observer];
+        [attachedMultiplexers addObject:multiplexer];
+    }
+
+    rz_unlockObject(self);
+
+    // resolving reads intermediate values and registers for KVO, which calls out and so must not happen while the stripe is held
+    for ( RZDBMultiplexer *multiplexer in attachedMultiplexers ) {
+        [multiplexer resolve];
+    }
+}
+
+- (void)rz_detachObserver:(RZDBObserver *)observer
+{
+    // keeps the affected multiplexers alive until their registrations are updated after unlocking
+    NSMutableArray *updatedMultiplexers = [NSMutableArray array];
+
+    rz_lockObject(self);
+
+    NSMutableDictionary *multiplexers = rz_multiplexers(self);
+    RZDBMultiplexer *multiplexer = multiplexers[observer.keyPath];
+
+    if ( multiplexer != nil ) {
+        [multiplexer removeObserver:observer];
+        [self rz_releaseMultiplexer:multiplexer fromMultiplexers:multiplexers updated:updatedMultiplexers];
+    }
+
+    rz_unlockObject(self);
+
+    for ( RZDBMultiplexer *updatedMultiplexer in updatedMultiplexers ) {
+        [updatedMultiplexer updateRegistration];
+    }
+}
+
+- (void)rz_detachObservers:(NSArray *)observers
+{
+    // keeps the affected multiplexers alive until their registrations are updated after unlocking
+    NSMutableArray *updatedMultiplexers = [NSMutableArray array];
+
+    rz_lockObject(self);
+
+    NSMutableDictionary *multiplexers = rz_multiplexers(self);
+
+    // key paths are interned, so grouping by address groups observers of the same key path
+    for ( NSArray *group in [rz_groupObservers(observers, ^id (RZDBObserver *observer) { return observer.keyPath; }) objectEnumerator] ) {
+        NSString *keyPath = [group.firstObject keyPath];
+        RZDBMultiplexer *multiplexer = multiplexers[keyPath];
+
+        if ( multiplexer != nil ) {
+            [multiplexer removeObservers:group];
+            [self rz_releaseMultiplexer:multiplexer fromMultiplexers:multiplexers updated:updatedMultiplexers];
+        }
+    }
+
+    rz_unlockObject(self);
+
+    for ( RZDBMultiplexer *multiplexer in updatedMultiplexers ) {
+        [multiplexer updateRegistration];
+    }
+}
+
+- (void)rz_invalidateMultiplexers
+{
+    rz_lockObject(self);
+
+    // the dictionary keeps the multiplexers alive until after unlocking
+    NSMutableDictionary *multiplexers = rz_multiplexers(self);
+    rz_setMultiplexers(self, nil);
+
+    for ( RZDBMultiplexer *multiplexer in [multiplexers objectEnumerator] ) {
+        [multiplexer invalidate];
+    }
+
+    rz_unlockObject(self);
+
+    // invalidated multiplexers unregister once the stripe has been released
+    for ( RZDBMultiplexer *multiplexer in [multiplexers objectEnumerator] ) {
+        [multiplexer updateRegistration];
+    }
+}
+
+- (RZDBMultiplexer *)rz_multiplexerForKeyPath:(NSString *)keyPath inMultiplexers:(NSMutableDictionary *)multiplexers
+{
+    RZDBMultiplexer *multiplexer = multiplexers[keyPath];
+
+    if ( multiplexer == nil ) {
+        NSString *parentKeyPath = rz_parentKeyPath(keyPath);
+        RZDBMultiplexer *parent = (parentKeyPath != nil) ? [self rz_multiplexerForKeyPath:parentKeyPath inMultiplexers:multiplexers] : nil;
+
+        multiplexer = [[RZDBMultiplexer alloc] initWithObservedObject:self keyPath:keyPath parent:parent];
+        multiplexers[multiplexer.keyPath] = multiplexer;
+    }
+
+    return multiplexer;
+}
+
+- (void)rz_releaseMultiplexer:(RZDBMultiplexer *)multiplexer fromMultiplexers:(NSMutableDictionary *)multiplexers updated:(NSMutableArray *)updatedMultiplexers
+{
+    // a prefix is released along with its last child, unless it is observed itself
+    while ( multiplexer != nil && !multiplexer.isInUse ) {
+        RZDBMultiplexer *parent = multiplexer.parent;
+
+        [multiplexer invalidate];
+        [multiplexers removeObjectForKey:multiplexer.keyPath];
+        [updatedMultiplexers addObject:multiplexer];
+
+        multiplexer = parent;
+    }
+
+    // the remaining multiplexer may need fewer options, or no longer need prior notifications for its children
+    if ( multiplexer != nil ) {
+        [updatedMultiplexers addObject:multiplexer];
+    }
+}
+
+- (void)rz_cleanupObservers
+{
+    // Rather than invalidating observers one at a time, which locks and searches every container and multiplexer
+    // once per observer, detach them in bulk: each container is emptied or pruned under a single lock,
+    // and each KVO registration of the receiver is removed once rather than re-filtered per observer.
+    NSArray *registeredObservers = [rz_registeredObservers(self) removeAllObservers];
+    NSArray *dependentObservers = [rz_dependentObservers(self) removeAllObservers];
+
+    if ( registeredObservers.count == 0 && dependentObservers.count == 0 ) {
+        return;
+    }
+
+    [self rz_invalidateMultiplexers];
+
+    // the targets of the receiver's observers no longer depend on them. Targets are read from the callback, so this must precede -clear.
+    for ( NSArray *group in [rz_groupObservers(registeredObservers, ^id (RZDBObserver *observer) { return observer.target; }) objectEnumerator] ) {
+        id target = [group.firstObject target];
+
+        if ( target != self ) {
+            [rz_dependentObservers(target) removeObservers:group];
+        }
+    }
+
+    // the objects the receiver observes no longer need to notify it
+    for ( NSArray *group in [rz_groupObservers(dependentObservers, ^id (RZDBObserver *observer) { return observer.observedObject; }) objectEnumerator] ) {
+        NSObject *observedObject = [group.firstObject observedObject];
+
+        if ( observedObject != self ) {
+            [rz_registeredObservers(observedObject) removeObservers:group];
+            [observedObject rz_detachObservers:group];
+        }
+    }
+
+    for ( RZDBObserver *observer in registeredObservers ) {
+        [observer clear];
+    }
+
+    for ( RZDBObserver *observer in dependentObservers ) {
+        [observer clear];
+    }
+}
+
+@end
+
+#pragma mark - RZDBObserver implementation
+
+@implementation RZDBObserver {
+    // packed into the padding after isa
+    uint16_t _observationOptions;
+    uint16_t _callbackOptions;
+
+    RZDBObserverExtras *_extras;
+}
+
+- (instancetype)initWithObservedObject:(NSObject *)observedObject keyPath:(NSString *)keyPath observationOptions:(NSKeyValueObservingOptions)observingOptions
+{
+    self = [super init];
+    if ( self != nil ) {
+        _observedObject = observedObject;
+        _keyPath = rz_internString(keyPath);
+        _observationOptions = (uint16_t)observingOptions;
+    }
+    
+    return self;
+}
+
+- (void)setKeyPath:(NSString *)keyPath
+{
+    _keyPath = rz_internString(keyPath);
+}
+
+- (void)setBoundKey:(NSString *)boundKey
+{
+    _boundKey = rz_internString(boundKey);
+}
+
+- (NSKeyValueObservingOptions)observationOptions
+{
+    return _observationOptions;
+}
+
+- (void)setObservationOptions:(NSKeyValueObservingOptions)observationOptions
+{
+    _observationOptions = (uint16_t)observationOptions;
+}
+
+- (RZDBObservationOptions)callbackOptions
+{
+    return _callbackOptions;
+}
+
+- (void)setCallbackOptions:(RZDBObservationOptions)callbackOptions
+{
+    _callbackOptions = (uint16_t)callbackOptions;
+}
+
+- (id)target
+{
+    return self.callback.target;
+}
+
+- (SEL)action
+{
+    return self.callback.action;
+}
+
+- (RZDBKeyBindingTransform)bindingTransform
+{
+    return _extras.bindingTransform;
+}
+
+- (void)setBindingTransform:(RZDBKeyBindingTransform)bindingTransform
+{
+    [self extrasIfNeeded:(bindingTransform != nil)].bindingTransform = bindingTransform;
+}
+
+- (dispatch_queue_t)deliveryQueue
+{
+    return _extras.deliveryQueue;
+}
+
+- (void)setDeliveryQueue:(dispatch_queue_t)deliveryQueue
+{
+    [self extrasIfNeeded:(deliveryQueue != nil)].deliveryQueue = deliveryQueue;
+}
+
+- (RZDBRateLimiter *)rateLimiter
+{
+    return _extras.rateLimiter;
+}
+
+- (void)setRateLimiter:(RZDBRateLimiter *)rateLimiter
+{
+    [self extrasIfNeeded:(rateLimiter != nil)].rateLimiter = rateLimiter;
+}
+
+#if RZDB_INSTRUMENTATION
+- (RZDBStatistics *)statistics
+{
+    return _extras.statistics;
+}
+
+- (void)setStatistics:(RZDBStatistics *)statistics
+{
+    [self extrasIfNeeded:(statistics != nil)].statistics = statistics;
+}
+
+- (RZDBRecordSite)recordSite
+{
+    return (_extras != nil) ? _extras.recordSite : (RZDBRecordSite){ 0 };
+}
+
+- (void)setRecordSite:(RZDBRecordSite)recordSite
+{
+    [self extrasIfNeeded:YES].recordSite = recordSite;
+}
+#endif
+
+- (void)setCallback:(RZDBCallback *)callback boundKey:(NSString *)boundKey bindingTransform:(RZDBKeyBindingTransform)bindingTransform
+{
+    self.callback = callback;
+
+    self.boundKey = boundKey;
+    self.bindingTransform = bindingTransform;
+}
+
+- (RZDBChange *)notifyWithKVOChange:(NSDictionary *)kvoChange sharedChange:(RZDBChange *)change
+{
+    // changes to suspended targets or from suspended objects are held until they resume
+    if ( atomic_load_explicit(&kRZDBSuspensionCount, memory_order_relaxed) > 0 && [RZDBSuspension suspendKVOChange:kvoChange forObserver:self] ) {
+        return change;
+    }
+
+    if ( self.rateLimiter != nil ) {
+        [self.rateLimiter addKVOChange:kvoChange];
+        return change;
+    }
+    else if ( self.deliveryQueue != nil ) {
+        [RZDBDeliveryBatch enqueueKVOChange:kvoChange forObserver:self];
+        return change;
+    }
+
+    return [self deliverKVOChange:kvoChange sharedChange:change];
+}
+
+- (RZDBChange *)deliverKVOChange:(NSDictionary *)kvoChange sharedChange:(RZDBChange *)change
+{
+    RZDBCallback *callback = self.callback;
+
+    if ( callback != nil && !callback.isValid ) {
+        callback = [self resolveCallback:callback];
+    }
+
+    // a nil callback means the observer was invalidated
+    if ( callback == nil ) {
+        return change;
+    }
+
+    // ordered bindings are set once the change has propagated, from the values current at that time
+    if ( self.boundKey != nil && (self.callbackOptions & RZDBObservationOptionOrdered) && [RZDBPropagation enqueueBindingObserver:self] ) {
+        return change;
+    }
+
+#if RZDB_INSTRUMENTATION
+    RZDBStatistics *statistics = self.statistics;
+    uint64_t start = rz_instrumentationTime();
+
+    if ( statistics != nil ) {
+        rz_recordNotification(statistics);
+    }
+#endif
+
+    if ( self.typedBinding != nil ) {
+        [self.typedBinding applyFromObject:self.observedObject toObject:callback.target];
+    }
+    else if ( self.boundKey != nil && callback.action == @selector(rz_setBoundArrayKey:withKVOChange:) ) {
+        // array bindings apply the change's indexes, so they need the raw KVO change
+        ((void(*)(id, SEL, NSString *, NSDictionary *))callback.implementation)(callback.target, callback.action, self.boundKey, kvoChange);
+    }
+    else if ( self.boundKey != nil ) {
+        // bindings call rz_setBoundKey:withValue:transform: directly, without a change dictionary
+        id value = kvoChange[NSKeyValueChangeNewKey];
+
+        ((void(*)(id, SEL, NSString *, id, RZDBKeyBindingTransform))callback.implementation)(callback.target, callback.action, self.boundKey, RZDBNotNull(value) ? value : nil, self.bindingTransform);
+    }
+    else {
+        if ( callback.passesChange && change == nil ) {
+            change = [[RZDBChange alloc] initWithObject:self.observedObject keyPath:self.keyPath kvoChange:kvoChange];
+        }
+
+        NSDictionary *callbackChange = callback.passesChange ? change : nil;
+
+        BOOL coalesced = ((self.callbackOptions & RZDBObservationOptionCoalesce) && [RZDBCoalesce rz_coalesceTarget:callback.target action:callback.action change:callbackChange]);
+        coalesced = coalesced || ((self.callbackOptions & RZDBObservationOptionOrdered) && [RZDBPropagation deferTarget:callback.target action:callback.action change:callbackChange]);
+
+        if ( coalesced ) {
+#if RZDB_INSTRUMENTATION
+            if ( rz_isRecording() ) {
+                rz_appendRecord(self.recordSite, RZDB_RECORD_FLAG_COALESCED, start, 0, 0);
+            }
+#endif
+            return change;
+        }
+
+        if ( callback.passesChange ) {
+            ((void(*)(id, SEL, NSDictionary *))callback.implementation)(callback.target, callback.action, callbackChange);
+        }
+        else {
+            ((void(*)(id, SEL))callback.implementation)(callback.target, callback.action);
+        }
+    }
+
+#if RZDB_INSTRUMENTATION
+    uint64_t duration = rz_instrumentationTime() - start;
+
+    if ( statistics != nil ) {
+        rz_recordCallbackLatency(statistics, duration);
+    }
+
+    if ( rz_isRecording() ) {
+        rz_appendRecord(self.recordSite, RZDB_RECORD_FLAG_DELIVERED, start, duration, 0);
+    }
+#endif
+
+    return change;
+}
+
+- (void)deliverDeferredKVOChange:(NSDictionary *)kvoChange target:(id)target
+{
+    // the callback's own target is unretained, and is only safe to message while the argument keeps it alive
+    if ( target != nil && target == self.target ) {
+        [self deliverKVOChange:kvoChange sharedChange:nil];
+    }
+}
+
+- (RZDBCallback *)resolveCallback:(RZDBCallback *)staleCallback
+{
+    rz_lockObject(self);
+
+    RZDBCallback *callback = self.callback;
+
+    // only replace the stale callback, so that an invalidated observer stays invalidated
+    if ( callback == staleCallback ) {
+        callback = [RZDBCallback callbackWithTarget:staleCallback.target action:staleCallback.action];
+        self.callback = callback;
+    }
+
+    rz_unlockObject(self);
+
+    return callback;
+}
+
+- (void)applyCurrentValue
+{
+    RZDBCallback *callback = self.callback;
+
+    if ( callback != nil && !callback.isValid ) {
+        callback = [self resolveCallback:callback];
+    }
+
+    NSObject *observedObject = self.observedObject;
+
+    // the observer may have been invalidated while it was pending
+    if ( callback == nil || observedObject == nil ) {
+        return;
+    }
+
+#if RZDB_INSTRUMENTATION
+    uint64_t start = rz_instrumentationTime();
+#endif
+
+    if ( self.typedBinding != nil ) {
+        [self.typedBinding applyFromObject:observedObject toObject:callback.target];
+    }
+    else {
+        id value = [[RZDBKeyPath keyPathWithString:self.keyPath forClass:object_getClass(observedObject)] valueForObject:observedObject];
+
+        ((void(*)(id, SEL, NSString *, id, RZDBKeyBindingTransform))callback.implementation)(callback.target, callback.action, self.boundKey, value, self.bindingTransform);
+    }
+
+#if RZDB_INSTRUMENTATION
+    if ( rz_isRecording() ) {
+        rz_appendRecord(self.recordSite, RZDB_RECORD_FLAG_DELIVERED, start, rz_instrumentationTime() - start, 0);
+    }
+#endif
+}
+
+- (id)collectionForKVOChange:(NSDictionary *)kvoChange
+{
+    if ( [kvoChange[NSKeyValueChangeKindKey] unsignedIntegerValue] == NSKeyValueChangeSetting ) {
+        return nil;
+    }
+
+    NSObject *observedObject = self.observedObject;
+
+    return [[[RZDBKeyPath keyPathWithString:self.keyPath forClass:object_getClass(observedObject)] valueForObject:observedObject] copy];
+}
+
+- (NSDictionary *)initialKVOChange
+{
+    NSDictionary *change = @{ NSKeyValueChangeKindKey : @(NSKeyValueChangeSetting) };
+
+    if ( self.observationOptions & NSKeyValueObservingOptionNew ) {
+        NSObject *observedObject = self.observedObject;
+        id value = [[RZDBKeyPath keyPathWithString:self.keyPath forClass:object_getClass(observedObject)] valueForObject:observedObject];
+
+        change = @{ NSKeyValueChangeKindKey : @(NSKeyValueChangeSetting),
+                    NSKeyValueChangeNewKey : value ?: [NSNull null] };
+    }
+
+    return change;
+}
+
+- (void)invalidate
+{
+    id observedObject = self.observedObject;
+
+    [rz_dependentObservers(self.target) removeObserver:self];
+    [rz_registeredObservers(observedObject) removeObserver:self];
+
+    [observedObject rz_detachObserver:self];
+
+    [self clear];
+}
+
+- (void)clear
+{
+    [self.rateLimiter cancel];
+
+    rz_lockObject(self);
+
+    // only the first clear of a registered observer counts, since it is the one that removes the callback
+    BOOL ordered = (self.callback != nil && (self.callbackOptions & RZDBObservationOptionOrdered));
+
+    self.observedObject = nil;
+    self.callback = nil;
+
+    rz_unlockObject(self);
+
+    if ( ordered ) {
+        atomic_fetch_sub_explicit(&kRZDBOrderedObserverCount, 1, memory_order_relaxed);
+    }
+}
+
+#pragma mark - private methods
+
+// returns nil, rather than allocating, if there is nothing to set
+- (RZDBObserverExtras *)extrasIfNeeded:(BOOL)needed
+{
+    if ( _extras == nil && needed ) {
+        _extras = [[RZDBObserverExtras alloc] init];
+    }
+
+    return _extras;
+}
+
+@end
+
+#pragma mark - RZDBObserverExtras implementation
+
+@implementation RZDBObserverExtras
+
+#if !OS_OBJECT_USE_OBJC
+- (void)dealloc
+{
+    if ( _deliveryQueue != NULL ) {
+        rz_dispatchRelease(_deliveryQueue);
+    }
+}
+
+- (void)setDeliveryQueue:(dispatch_queue_t)deliveryQueue
+{
+    if ( deliveryQueue != NULL ) {
+        rz_dispatchRetain(deliveryQueue);
+    }
+
+    if ( _deliveryQueue != NULL ) {
+        rz_dispatchRelease(_deliveryQueue);
+    }
+
+    _deliveryQueue = deliveryQueue;
+}
+#endif
+
+@end
+
+#pragma mark - RZDBChange implementation
+
+@implementation RZDBChange {
+    id _object;
+    id _old;
+    id _new;
+    NSString *_keyPath;
+
+    // only set for to-many changes
+    NSNumber *_kind;
+    NSIndexSet *_indexes;
+    NSIndexSet *_removedIndexes;
+    NSIndexSet *_insertedIndexes;
+
+    // built lazily, the first time the change is used as a dictionary
+    NSDictionary *_dictionary;
+}
+
+- (instancetype)initWithObject:(id)object keyPath:(NSString *)keyPath kvoChange:(NSDictionary *)kvoChange
+{
+    self = [super init];
+    if ( self != nil ) {
+        _object = object;
+        _keyPath = keyPath;
+
+        id oldValue = kvoChange[NSKeyValueChangeOldKey];
+        id newValue = kvoChange[NSKeyValueChangeNewKey];
+
+        _old = RZDBNotNull(oldValue) ? oldValue : nil;
+        _new = RZDBNotNull(newValue) ? newValue : nil;
+
+        NSNumber *kind = kvoChange[NSKeyValueChangeKindKey];
+        NSIndexSet *removedIndexes = kvoChange[kRZDBChangeKeyRemovedIndexes];
+
+        if ( kind != nil && (kind.unsignedIntegerValue != NSKeyValueChangeSetting || removedIndexes != nil) ) {
+            _kind = kind;
+            _indexes = kvoChange[NSKeyValueChangeIndexesKey];
+            _removedIndexes = removedIndexes;
+            _insertedIndexes = kvoChange[kRZDBChangeKeyInsertedIndexes];
+        }
+    }
+
+    return self;
+}
+
+- (id)objectForKey:(id)key
+{
+    // callers almost always pass the constants themselves, so check identity before equality
+    if ( key == kRZDBChangeKeyNew ) {
+        return _new;
+    }
+    else if ( key == kRZDBChangeKeyOld ) {
+        return _old;
+    }
+    else if ( key == kRZDBChangeKeyObject ) {
+        return _object;
+    }
+    else if ( key == kRZDBChangeKeyKeyPath ) {
+        return _keyPath;
+    }
+    else if ( key == kRZDBChangeKeyKind ) {
+        return _kind;
+    }
+    else if ( key == kRZDBChangeKeyIndexes ) {
+        return _indexes;
+    }
+
+    return self.dictionary[key];
+}
+
+- (NSUInteger)count
+{
+    return self.dictionary.count;
+}
+
+- (NSEnumerator *)keyEnumerator
+{
+    return [self.dictionary keyEnumerator];
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    return self;
+}
+
+#pragma mark - private methods
+
+- (NSDictionary *)dictionary
+{
+    // the change may be shared by observers on several threads, so it is built once under the lock stripe
+    rz_lockObject(self);
+
+    if ( _dictionary == nil ) {
+        NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+
+        if ( _object != nil ) {
+            dictionary[kRZDBChangeKeyObject] = _object;
+        }
+
+        if ( _old != nil ) {
+            dictionary[kRZDBChangeKeyOld] = _old;
+        }
+
+        if ( _new != nil ) {
+            dictionary[kRZDBChangeKeyNew] = _new;
+        }
+
+        if ( _keyPath != nil ) {
+            dictionary[kRZDBChangeKeyKeyPath] = _keyPath;
+        }
+
+        if ( _kind != nil ) {
+            dictionary[kRZDBChangeKeyKind] = _kind;
+        }
+
+        if ( _indexes != nil ) {
+            dictionary[kRZDBChangeKeyIndexes] = _indexes;
+        }
+
+        if ( _removedIndexes != nil ) {
+            dictionary[kRZDBChangeKeyRemovedIndexes] = _removedIndexes;
+            dictionary[kRZDBChangeKeyInsertedIndexes] = _insertedIndexes;
+        }
+
+        _dictionary = [dictionary copy];
+    }
+
+    NSDictionary *dictionary = _dictionary;
+
+    rz_unlockObject(self);
+
+    return dictionary;
+}
+
+@end
+
+#pragma mark - RZDBTypedBinding implementation
+
+typedef NS_ENUM(NSUInteger, RZDBTypedBindingType) {
+    RZDBTypedBindingTypeObject,
+    RZDBTypedBindingTypeChar,
+    RZDBTypedBindingTypeUnsignedChar,
+    RZDBTypedBindingTypeBool,
+    RZDBTypedBindingTypeShort,
+    RZDBTypedBindingTypeUnsignedShort,
+    RZDBTypedBindingTypeInt,
+    RZDBTypedBindingTypeUnsignedInt,
+    RZDBTypedBindingTypeLong,
+    RZDBTypedBindingTypeUnsignedLong,
+    RZDBTypedBindingTypeLongLong,
+    RZDBTypedBindingTypeUnsignedLongLong,
+    RZDBTypedBindingTypeFloat,
+    RZDBTypedBindingTypeDouble,
+#if RZDB_CORE_GRAPHICS
+    RZDBTypedBindingTypeCGPoint,
+    RZDBTypedBindingTypeCGSize,
+    RZDBTypedBindingTypeCGRect,
+#endif
+    RZDBTypedBindingTypeNSRange,
+};
+
+// the values are compared the way the boxed values are by isEqual: on the KVC path, so that the same setter calls are skipped.
+// In particular, 0.0 equals -0.0, and NaN equals NaN regardless of payload.
+#define RZDB_SCALAR_EQUAL(a, b) ((a) == (b))
+
+static inline BOOL rz_floatEqual(double a, double b)
+{
+    return (a == b) || (isnan(a) && isnan(b));
+}
+
+#if RZDB_CORE_GRAPHICS
+static inline BOOL rz_pointEqual(CGPoint a, CGPoint b)
+{
+    return rz_floatEqual(a.x, b.x) && rz_floatEqual(a.y, b.y);
+}
+
+static inline BOOL rz_sizeEqual(CGSize a, CGSize b)
+{
+    return rz_floatEqual(a.width, b.width) && rz_floatEqual(a.height, b.height);
+}
+
+static inline BOOL rz_rectEqual(CGRect a, CGRect b)
+{
+    return rz_pointEqual(a.origin, b.origin) && rz_sizeEqual(a.size, b.size);
+}
+#endif
+
+// reads the value from the source, and only calls the setter if the value differs from the destination's current value
+#define RZDB_APPLY_TYPED_BINDING(type, equal) { \
+    type value = ((type (*)(id, SEL))getterIMP)(object, _getter); \
+    type currentValue = ((type (*)(id, SEL))targetGetterIMP)(target, _targetGetter); \
+    if ( !equal(value, currentValue) ) { \
+        ((void (*)(id, SEL, type))setterIMP)(target, _setter, value); \
+    } \
+} break
+
+// like RZDB_APPLY_TYPED_BINDING, but passes the value through the binding's transform pipeline
+#define RZDB_APPLY_TRANSFORMED_BINDING(type, equal, transformMethod) { \
+    type value = [_transform transformMethod:((type (*)(id, SEL))getterIMP)(object, _getter)]; \
+    type currentValue = ((type (*)(id, SEL))targetGetterIMP)(target, _targetGetter); \
+    if ( !equal(value, currentValue) ) { \
+        ((void (*)(id, SEL, type))setterIMP)(target, _setter, value); \
+    } \
+} break
+
+@implementation RZDBTypedBinding {
+    RZDBTypedBindingType _type;
+    RZDBTransformPipeline *_transform;
+
+    SEL _getter;
+    SEL _targetGetter;
+    SEL _setter;
+
+    // the IMPs are resolved for these classes, and looked up again for objects of any other class (e.g. a KVO subclass),
+    // or once rz_invalidateCallbackCache() has been called since they were resolved.
+    // they are written once, before _resolved is set, so reading them after _resolved needs no lock.
+    __unsafe_unretained Class _objectClass;
+    __unsafe_unretained Class _targetClass;
+
+    IMP _getterIMP;
+    IMP _targetGetterIMP;
+    IMP _setterIMP;
+
+    uint_fast32_t _generation;
+    atomic_bool _resolved;
+}
+
++ (instancetype)bindingFromKeyPath:(NSString *)keyPath ofObject:(id)object toKey:(NSString *)key ofObject:(id)target transform:(RZDBTransformPipeline *)transform
+{
+    RZDBTypedBinding *binding = nil;
+
+    if ( [keyPath rangeOfString:@"."].location == NSNotFound ) {
+        binding = [[self alloc] initWithKey:keyPath ofObject:object toKey:key ofObject:target transform:transform];
+    }
+
+    return binding;
+}
+
+- (instancetype)initWithKey:(NSString *)key ofObject:(id)object toKey:(NSString *)targetKey ofObject:(id)target transform:(RZDBTransformPipeline *)transform
+{
+    self = [super init];
+    if ( self != nil ) {
+        objc_property_t property = class_getProperty(object_getClass(object), key.UTF8String);
+        objc_property_t targetProperty = class_getProperty(object_getClass(target), targetKey.UTF8String);
+
+        if ( property == NULL || targetProperty == NULL ) {
+            return nil;
+        }
+
+        char *type = property_copyAttributeValue(property, "T");
+        char *targetType = property_copyAttributeValue(targetProperty, "T");
+        char *readonly = property_copyAttributeValue(targetProperty, "R");
+
+        BOOL typesMatch = (type != NULL && targetType != NULL && readonly == NULL && [self resolveType:type matchingType:targetType]);
+
+        if ( typesMatch && transform != nil ) {
+            typesMatch = [self resolveTransform:transform forType:type];
+        }
+
+        free(type);
+        free(targetType);
+        free(readonly);
+
+        if ( !typesMatch ) {
+            return nil;
+        }
+
+        _getter = [self getterForProperty:property key:key];
+        _targetGetter = [self getterForProperty:targetProperty key:targetKey];
+        _setter = [self setterForProperty:targetProperty key:targetKey];
+
+        if ( ![object respondsToSelector:_getter] || ![target respondsToSelector:_targetGetter] || ![target respondsToSelector:_setter] ) {
+            return nil;
+        }
+    }
+
+    return self;
+}
+
+- (void)resolveForObject:(id)object target:(id)target
+{
+    _generation = atomic_load_explicit(&kRZDBCallbackGeneration, memory_order_acquire);
+
+    _objectClass = object_getClass(object);
+    _targetClass = object_getClass(target);
+
+    _getterIMP = class_getMethodImplementation(_objectClass, _getter);
+    _targetGetterIMP = class_getMethodImplementation(_targetClass, _targetGetter);
+    _setterIMP = class_getMethodImplementation(_targetClass, _setter);
+
+    atomic_store_explicit(&_resolved, true, memory_order_release);
+}
+
+- (void)applyFromObject:(id)object toObject:(id)target
+{
+    BOOL resolved = atomic_load_explicit(&_resolved, memory_order_acquire);
+
+    // a getter or setter may have been swizzled since the IMPs were resolved
+    resolved = resolved && (atomic_load_explicit(&kRZDBCallbackGeneration, memory_order_relaxed) == _generation);
+
+    IMP getterIMP = _getterIMP;
+    IMP targetGetterIMP = _targetGetterIMP;
+    IMP setterIMP = _setterIMP;
+
+    Class objectClass = object_getClass(object);
+    Class targetClass = object_getClass(target);
+
+    if ( !resolved || objectClass != _objectClass ) {
+        getterIMP = class_getMethodImplementation(objectClass, _getter);
+    }
+
+    // this is important for observed targets, whose KVO subclass overrides the setter to send notifications
+    if ( !resolved || targetClass != _targetClass ) {
+        targetGetterIMP = class_getMethodImplementation(targetClass, _targetGetter);
+        setterIMP = class_getMethodImplementation(targetClass, _setter);
+    }
+
+    // resolveTransform:forType: only accepts a transform for these types
+    if ( _transform != nil ) {
+        switch ( _type ) {
+            case RZDBTypedBindingTypeChar:      RZDB_APPLY_TRANSFORMED_BINDING(char, RZDB_SCALAR_EQUAL, transformBool);
+            case RZDBTypedBindingTypeBool:      RZDB_APPLY_TRANSFORMED_BINDING(bool, RZDB_SCALAR_EQUAL, transformBool);
+            case RZDBTypedBindingTypeFloat:     RZDB_APPLY_TRANSFORMED_BINDING(float, rz_floatEqual, transformDouble);
+            case RZDBTypedBindingTypeDouble:    RZDB_APPLY_TRANSFORMED_BINDING(double, rz_floatEqual, transformDouble);
+#if RZDB_CORE_GRAPHICS
+            case RZDBTypedBindingTypeCGRect:    RZDB_APPLY_TRANSFORMED_BINDING(CGRect, rz_rectEqual, transformRect);
+#endif
+            default: break;
+        }
+
+        return;
+    }
+
+    switch ( _type ) {
+        case RZDBTypedBindingTypeObject: {
+            id value = ((id (*)(id, SEL))getterIMP)(object, _getter);
+            id currentValue = ((id (*)(id, SEL))targetGetterIMP)(target, _targetGetter);
+
+            if ( currentValue != value && ![currentValue isEqual:value] ) {
+                ((void (*)(id, SEL, id))setterIMP)(target, _setter, value);
+            }
+        } break;
+
+        case RZDBTypedBindingTypeChar:              RZDB_APPLY_TYPED_BINDING(char, RZDB_SCALAR_EQUAL);
+        case RZDBTypedBindingTypeUnsignedChar:      RZDB_APPLY_TYPED_BINDING(unsigned char, RZDB_SCALAR_EQUAL);
+        case RZDBTypedBindingTypeBool:              RZDB_APPLY_TYPED_BINDING(bool, RZDB_SCALAR_EQUAL);
+        case RZDBTypedBindingTypeShort:             RZDB_APPLY_TYPED_BINDING(short, RZDB_SCALAR_EQUAL);
+        case RZDBTypedBindingTypeUnsignedShort:     RZDB_APPLY_TYPED_BINDING(unsigned short, RZDB_SCALAR_EQUAL);
+        case RZDBTypedBindingTypeInt:               RZDB_APPLY_TYPED_BINDING(int, RZDB_SCALAR_EQUAL);
+        case RZDBTypedBindingTypeUnsignedInt:       RZDB_APPLY_TYPED_BINDING(unsigned int, RZDB_SCALAR_EQUAL);
+        case RZDBTypedBindingTypeLong:              RZDB_APPLY_TYPED_BINDING(long, RZDB_SCALAR_EQUAL);
+        case RZDBTypedBindingTypeUnsignedLong:      RZDB_APPLY_TYPED_BINDING(unsigned long, RZDB_SCALAR_EQUAL);
+        case RZDBTypedBindingTypeLongLong:          RZDB_APPLY_TYPED_BINDING(long long, RZDB_SCALAR_EQUAL);
+        case RZDBTypedBindingTypeUnsignedLongLong:  RZDB_APPLY_TYPED_BINDING(unsigned long long, RZDB_SCALAR_EQUAL);
+        case RZDBTypedBindingTypeFloat:             RZDB_APPLY_TYPED_BINDING(float, rz_floatEqual);
+        case RZDBTypedBindingTypeDouble:            RZDB_APPLY_TYPED_BINDING(double, rz_floatEqual);
+#if RZDB_CORE_GRAPHICS
+        case RZDBTypedBindingTypeCGPoint:           RZDB_APPLY_TYPED_BINDING(CGPoint, rz_pointEqual);
+        case RZDBTypedBindingTypeCGSize:            RZDB_APPLY_TYPED_BINDING(CGSize, rz_sizeEqual);
+        case RZDBTypedBindingTypeCGRect:            RZDB_APPLY_TYPED_BINDING(CGRect, rz_rectEqual);
+#endif
+        case RZDBTypedBindingTypeNSRange:           RZDB_APPLY_TYPED_BINDING(NSRange, NSEqualRanges);
+    }
+}
+
+#pragma mark - private methods
+
+- (BOOL)resolveType:(const char *)type matchingType:(const char *)targetType
+{
+    static const struct { const char *encoding; RZDBTypedBindingType type; } kRZDBTypedBindingEncodings[] = {
+        { @encode(char),                RZDBTypedBindingTypeChar },
+        { @encode(unsigned char),       RZDBTypedBindingTypeUnsignedChar },
+        { @encode(bool),                RZDBTypedBindingTypeBool },
+        { @encode(short),               RZDBTypedBindingTypeShort },
+        { @encode(unsigned short),      RZDBTypedBindingTypeUnsignedShort },
+        { @encode(int),                 RZDBTypedBindingTypeInt },
+        { @encode(unsigned int),        RZDBTypedBindingTypeUnsignedInt },
+        { @encode(long),                RZDBTypedBindingTypeLong },
+        { @encode(unsigned long),       RZDBTypedBindingTypeUnsignedLong },
+        { @encode(long long),           RZDBTypedBindingTypeLongLong },
+        { @encode(unsigned long long),  RZDBTypedBindingTypeUnsignedLongLong },
+        { @encode(float),               RZDBTypedBindingTypeFloat },
+        { @encode(double),              RZDBTypedBindingTypeDouble },
+#if RZDB_CORE_GRAPHICS
+        { @encode(CGPoint),             RZDBTypedBindingTypeCGPoint },
+        { @encode(CGSize),              RZDBTypedBindingTypeCGSize },
+        { @encode(CGRect),              RZDBTypedBindingTypeCGRect },
+#endif
+        { @encode(NSRange),             RZDBTypedBindingTypeNSRange },
+    };
+
+    // any two object types can be bound, just like with KVC
+    if ( type[0] == _C_ID && targetType[0] == _C_ID ) {
+        _type = RZDBTypedBindingTypeObject;
+        return YES;
+    }
+
+    if ( strcmp(type, targetType) != 0 ) {
+        return NO;
+    }
+
+    for ( size_t i = 0; i < sizeof(kRZDBTypedBindingEncodings) / sizeof(kRZDBTypedBindingEncodings[0]); i++ ) {
+        if ( strcmp(type, kRZDBTypedBindingEncodings[i].encoding) == 0 ) {
+            _type = kRZDBTypedBindingEncodings[i].type;
+            return YES;
+        }
+    }
+
+    return NO;
+}
+
+- (BOOL)resolveTransform:(RZDBTransformPipeline *)transform forType:(const char *)type
+{
+    const char *encoding = transform.valueEncoding;
+
+    // a double transform is also applied to floats, so that it works for CGFloat keys on any architecture
+    BOOL resolved = (encoding != NULL && (strcmp(type, encoding) == 0 || (_type == RZDBTypedBindingTypeFloat && strcmp(encoding, @encode(double)) == 0)));
+
+    if ( resolved ) {
+        _transform = transform;
+    }
+
+    return resolved;
+}
+
+- (SEL)getterForProperty:(objc_property_t)property key:(NSString *)key
+{
+    char *getterName = property_copyAttributeValue(property, "G");
+    SEL getter = (getterName != NULL) ? sel_registerName(getterName) : NSSelectorFromString(key);
+
+    free(getterName);
+
+    return getter;
+}
+
+- (SEL)setterForProperty:(objc_property_t)property key:(NSString *)key
+{
+    char *setterName = property_copyAttributeValue(property, "S");
+    SEL setter = NULL;
+
+    if ( setterName != NULL ) {
+        setter = sel_registerName(setterName);
+    }
+    else {
+        NSString *capitalizedKey = [[key substringToIndex:1].uppercaseString stringByAppendingString:[key substringFromIndex:1]];
+        setter = NSSelectorFromString([NSString stringWithFormat:@"set%@:", capitalizedKey]);
+    }
+
+    free(setterName);
+
+    return setter;
+}
+
+@end
+
+#pragma mark - RZDBCallback implementation
+
+@implementation RZDBCallback {
+    Class _targetClass;
+    uint_fast32_t _generation;
+}
+
++ (instancetype)callbackWithTarget:(id)target action:(SEL)action
+{
+    return [[self alloc] initWithTarget:target action:action];
+}
+
+- (instancetype)initWithTarget:(id)target action:(SEL)action
+{
+    self = [super init];
+    if ( self != nil ) {
+        _target = target;
+        _action = action;
+
+        _generation = atomic_load_explicit(&kRZDBCallbackGeneration, memory_order_acquire);
+        _targetClass = object_getClass(target);
+
+        // for targets that don't implement the action (e.g. proxies) this is the forwarding IMP,
+        // so calling it is still equivalent to messaging the target
+        _implementation = class_getMethodImplementation(_targetClass, action);
+
+        // read the arity from the method itself where possible, since building an NSMethodSignature allocates
+        Method method = class_getInstanceMethod(_targetClass, action);
+
+        if ( method != NULL ) {
+            _passesChange = (method_getNumberOfArguments(method) > 2);
+        }
+        else {
+            _passesChange = ([target methodSignatureForSelector:action].numberOfArguments > 2);
+        }
+    }
+
+    return self;
+}
+
+- (BOOL)isValid
+{
+    return (object_getClass(_target) == _targetClass &&
+            atomic_load_explicit(&kRZDBCallbackGeneration, memory_order_relaxed) == _generation);
+}
+
+@end
+
+#pragma mark - RZDBMultiplexer implementation
+
+@implementation RZDBMultiplexer {
+    // guards the state below that isn't guarded by the observed object's lock stripe
+    pthread_mutex_t _lock;
+
+    // the key observed on _object: the last key of the key path, or the whole key path if there is no parent
+    NSString *_key;
+
+    // the object that the parent's key path leads to, or the observed object if there is no parent.
+    // nil if the path is broken, or if the multiplexer hasn't been resolved yet.
+    __unsafe_unretained id _object;
+    BOOL _resolved;
+
+    // incremented whenever _object changes or the children are attached to a new value,
+    // so that a value read without the lock can be checked against the object it was read from
+    NSUInteger _generation;
+
+    // the object and options of the current KVO registration, if any
+    __unsafe_unretained id _registeredObject;
+    NSKeyValueObservingOptions _registeredOptions;
+
+    // the value of the key path before an intermediate object was replaced, for observers that need old values
+    id _replacedValue;
+
+    // guarded by the observed object's lock stripe
+    NSMutableArray *_observerList;
+    NSArray *_observersSnapshot;
+    NSMutableArray *_children;
+    BOOL _invalidated;
+
+#if RZDB_INSTRUMENTATION
+    RZDBRecordSite _recordSite;
+#endif
+}
+
+- (instancetype)initWithObservedObject:(NSObject *)observedObject keyPath:(NSString *)keyPath parent:(RZDBMultiplexer *)parent
+{
+    self = [super init];
+    if ( self != nil ) {
+        _observedObject = observedObject;
+        _keyPath = rz_internString(keyPath);
+        _observerList = [NSMutableArray array];
+        _children = [NSMutableArray array];
+
+        if ( parent != nil ) {
+            // the object is resolved later, since reading the parent's value calls out to a getter
+            _parent = parent;
+            _key = rz_internString([_keyPath substringFromIndex:parent.keyPath.length + 1]);
+
+            [parent addChild:self];
+        }
+        else {
+            _key = _keyPath;
+            _object = observedObject;
+            _resolved = YES;
+        }
+
+#if RZDB_INSTRUMENTATION
+        _recordSite = rz_recordSite([observedObject class], _keyPath, Nil, NULL, nil);
+#endif
+
+        rz_initRecursiveMutex(&_lock);
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    pthread_mutex_destroy(&_lock);
+}
+
+- (void)addObserver:(RZDBObserver *)observer
+{
+    // if the new observer needs values the existing registration doesn't provide, the next update re-registers with the superset
+    _observationOptions |= (observer.observationOptions & kRZDBMultiplexedOptions);
+
+    [_observerList addObject:observer];
+    _observersSnapshot = nil;
+}
+
+- (void)removeObserver:(RZDBObserver *)observer
+{
+    NSUInteger idx = [_observerList indexOfObjectIdenticalTo:observer];
+
+    if ( idx != NSNotFound ) {
+        [_observerList removeObjectAtIndex:idx];
+        [self observersRemoved];
+    }
+}
+
+- (void)removeObservers:(NSArray *)observers
+{
+    // filter once, rather than searching the observers once per removed observer
+    NSHashTable *removedObservers = [NSHashTable hashTableWithOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsObjectPointerPersonality];
+
+    for ( RZDBObserver *observer in observers ) {
+        [removedObservers addObject:observer];
+    }
+
+    NSIndexSet *indexes = [_observerList indexesOfObjectsPassingTest:^BOOL(RZDBObserver *observer, NSUInteger idx, BOOL *stop) {
+        return [removedObservers containsObject:observer];
+    }];
+
+    if ( indexes.count > 0 ) {
+        [_observerList removeObjectsAtIndexes:indexes];
+        [self observersRemoved];
+    }
+}
+
+- (BOOL)isInUse
+{
+    return (_observerList.count > 0 || _children.count > 0);
+}
+
+- (void)invalidate
+{
+    _invalidated = YES;
+
+    [_parent removeChild:self];
+    _parent = nil;
+
+    [_children removeAllObjects];
+    [_observerList removeAllObjects];
+    _observersSnapshot = nil;
+}
+
+- (void)resolve
+{
+    RZDBMultiplexer *parent = self.parent;
+
+    // the parent is registered before its value is read, so that a change made in between re-attaches this multiplexer
+    if ( parent != nil ) {
+        [parent resolve];
+        [parent attachChild:self];
+    }
+
+    [self updateRegistration];
+}
+
+- (void)updateRegistration
+{
+    pthread_mutex_lock(&_lock);
+
+    rz_lockObject(_observedObject);
+
+    NSKeyValueObservingOptions options = _observationOptions;
+
+    // a parent is notified before its intermediate object is replaced, so that its children can leave the old object
+    if ( _children.count > 0 ) {
+        options |= NSKeyValueObservingOptionPrior;
+    }
+
+    BOOL needed = (!_invalidated && (_observerList.count > 0 || _children.count > 0));
+
+    rz_unlockObject(_observedObject);
+
+    id object = needed ? _object : nil;
+
+    // a descendant that missed the prior notification is still registered with the old object
+    if ( _registeredObject != nil && (_registeredObject != object || options != _registeredOptions) ) {
+        [self unregister];
+    }
+
+    if ( object != nil && _registeredObject == nil ) {
+        [object addObserver:self forKeyPath:_key options:options context:kRZDBKVOContext];
+
+        _registeredObject = object;
+        _registeredOptions = options;
+    }
+
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary *)change context:(void *)context
+{
+    if ( context != kRZDBKVOContext ) {
+        return;
+    }
+
+    // only multiplexers with children ask for prior notifications, which are never sent to observers.
+    // The intermediate object is about to be replaced, so the children leave it while it is still alive.
+    if ( [change[NSKeyValueChangeNotificationIsPriorKey] boolValue] ) {
+        [self detachChildren];
+        return;
+    }
+
+    NSMutableArray *descendants = nil;
+    NSMutableArray *descendantChanges = nil;
+
+    NSArray *children = [self children];
+
+    if ( children.count > 0 ) {
+        descendants = [NSMutableArray array];
+        descendantChanges = [NSMutableArray array];
+
+        [self attachChildren:children descendants:descendants changes:descendantChanges];
+    }
+
+    // ordered bindings and callbacks are deferred until the outermost change has been fanned out
+    BOOL propagating = (atomic_load_explicit(&kRZDBOrderedObserverCount, memory_order_relaxed) > 0);
+
+    if ( propagating ) {
+        [RZDBPropagation begin];
+    }
+
+    @try {
+        [self fanOutKVOChange:change];
+
+        // every key path below a replaced intermediate object has changed, as with KVO's own key path observation
+        [descendants enumerateObjectsUsingBlock:^(RZDBMultiplexer *descendant, NSUInteger idx, BOOL *stop) {
+            [descendant fanOutKVOChange:descendantChanges[idx]];
+        }];
+    }
+    @catch (id exception) {
+        // the deferred work is discarded rather than sent while the exception unwinds
+        if ( propagating ) {
+            [RZDBPropagation abort];
+        }
+
+        @throw;
+    }
+
+    if ( propagating ) {
+        [RZDBPropagation commit];
+    }
+}
+
+- (NSArray *)observers
+{
+    rz_lockObject(_observedObject);
+
+    if ( _observersSnapshot == nil ) {
+        _observersSnapshot = [_observerList copy];
+    }
+
+    NSArray *observers = _observersSnapshot;
+
+    rz_unlockObject(_observedObject);
+
+    return observers;
+}
+
+#pragma mark - private methods
+
+// must be called with the observed object's lock stripe held
+- (void)observersRemoved
+{
+    _observersSnapshot = nil;
+
+    // narrow the registration once no remaining observer needs the values that the removed ones did
+    NSKeyValueObservingOptions options = kNilOptions;
+
+    for ( RZDBObserver *observer in _observerList ) {
+        options |= (observer.observationOptions & kRZDBMultiplexedOptions);
+    }
+
+    _observationOptions = options;
+}
+
+// must be called with the observed object's lock stripe held
+- (void)addChild:(RZDBMultiplexer *)child
+{
+    [_children addObject:child];
+}
+
+// must be called with the observed object's lock stripe held
+- (void)removeChild:(RZDBMultiplexer *)child
+{
+    [_children removeObjectIdenticalTo:child];
+}
+
+- (NSArray *)children
+{
+    rz_lockObject(_observedObject);
+    NSArray *children = [_children copy];
+    rz_unlockObject(_observedObject);
+
+    return children;
+}
+
+- (void)fanOutKVOChange:(NSDictionary *)change
+{
+    // the snapshot is immutable, so observers may be added or removed during the fan out
+    NSArray *observers = self.observers;
+
+#if RZDB_INSTRUMENTATION
+    if ( rz_isRecording() ) {
+        rz_appendRecord(_recordSite, RZDB_RECORD_FLAG_CHANGE, rz_instrumentationTime(), 0, observers.count);
+    }
+#endif
+
+    // the change dictionary is immutable, so a single instance is shared by all observers
+    RZDBChange *sharedChange = nil;
+
+    for ( RZDBObserver *observer in observers ) {
+        sharedChange = [observer notifyWithKVOChange:change sharedChange:sharedChange];
+    }
+}
+
+// the value of the key on the given object. Calls the object's getter, so must be called without any lock held.
+- (id)valueOfObject:(id)object
+{
+    return (object != nil) ? [[RZDBKeyPath keyPathWithString:_key forClass:object_getClass(object)] valueForObject:object] : nil;
+}
+
+// reads the value of the key path without holding the lock, and then passes it to the block with the lock held,
+// once it is known to have been read from the current object. Returns the value.
+- (id)readValueAndApply:(void (^)(id value))block
+{
+    id value = nil;
+    BOOL valid = NO;
+
+    while ( !valid ) {
+        pthread_mutex_lock(&_lock);
+
+        NSUInteger generation = _generation;
+        id object = _object;
+
+        pthread_mutex_unlock(&_lock);
+
+        value = [self valueOfObject:object];
+
+        pthread_mutex_lock(&_lock);
+
+        // otherwise the object was replaced, or the children were attached by another thread, while the value was read
+        valid = (generation == _generation);
+
+        if ( valid ) {
+            block(value);
+        }
+
+        pthread_mutex_unlock(&_lock);
+    }
+
+    return value;
+}
+
+// attaches a child that hasn't been resolved yet to the object the key path currently leads to
+- (void)attachChild:(RZDBMultiplexer *)child
+{
+    pthread_mutex_lock(&child->_lock);
+    BOOL resolved = child->_resolved;
+    pthread_mutex_unlock(&child->_lock);
+
+    if ( !resolved ) {
+        [self readValueAndApply:^(id value) {
+            [child attachToObject:value onlyIfUnresolved:YES];
+        }];
+    }
+}
+
+// attaches the children to the object the key path now leads to, along with every descendant,
+// and collects the change each observed descendant should send
+- (void)attachChildren:(NSArray *)children descendants:(NSMutableArray *)descendants changes:(NSMutableArray *)changes
+{
+    [self readValueAndApply:^(id value) {
+        self->_generation++;
+
+        for ( RZDBMultiplexer *child in children ) {
+            [child attachToObject:value onlyIfUnresolved:NO];
+        }
+    }];
+
+    for ( RZDBMultiplexer *child in children ) {
+        NSDictionary *change = [child replacementKVOChange];
+
+        if ( change != nil ) {
+            [descendants addObject:child];
+            [changes addObject:change];
+        }
+
+        NSArray *grandchildren = [child children];
+
+        if ( grandchildren.count > 0 ) {
+            [child attachChildren:grandchildren descendants:descendants changes:changes];
+        }
+    }
+}
+
+// must be called with the parent's lock held
+- (void)attachToObject:(id)object onlyIfUnresolved:(BOOL)onlyIfUnresolved
+{
+    pthread_mutex_lock(&_lock);
+
+    if ( !(_resolved && onlyIfUnresolved) ) {
+        if ( !_resolved || object != _object ) {
+            _object = object;
+            _resolved = YES;
+            _generation++;
+        }
+
+        [self updateRegistration];
+    }
+
+    pthread_mutex_unlock(&_lock);
+}
+
+// the children leave the current intermediate object, along with every descendant
+- (void)detachChildren
+{
+    for ( RZDBMultiplexer *child in [self children] ) {
+        [child detach];
+    }
+}
+
+- (void)detach
+{
+    rz_lockObject(_observedObject);
+    BOOL needsOldValue = (_observerList.count > 0 && (_observationOptions & NSKeyValueObservingOptionOld));
+    rz_unlockObject(_observedObject);
+
+    pthread_mutex_lock(&_lock);
+
+    NSUInteger generation = _generation;
+    id object = _object;
+
+    pthread_mutex_unlock(&_lock);
+
+    // read while the key path still leads through the object that is about to be replaced
+    id replacedValue = needsOldValue ? [self valueOfObject:object] : nil;
+
+    [self detachChildren];
+
+    pthread_mutex_lock(&_lock);
+
+    // if another thread has attached this multiplexer since, the value is stale and the object is current
+    if ( generation == _generation ) {
+        if ( needsOldValue ) {
+            _replacedValue = replacedValue ?: [NSNull null];
+        }
+
+        _object = nil;
+        _generation++;
+
+        [self updateRegistration];
+    }
+
+    pthread_mutex_unlock(&_lock);
+}
+
+// the change to send to the observers of a descendant whose intermediate object was replaced, or nil if it has none
+- (NSDictionary *)replacementKVOChange
+{
+    rz_lockObject(_observedObject);
+
+    BOOL observed = (_observerList.count > 0);
+    NSKeyValueObservingOptions options = _observationOptions;
+
+    rz_unlockObject(_observedObject);
+
+    pthread_mutex_lock(&_lock);
+
+    id replacedValue = _replacedValue;
+    _replacedValue = nil;
+
+    pthread_mutex_unlock(&_lock);
+
+    if ( !observed ) {
+        return nil;
+    }
+
+    NSMutableDictionary *change = [NSMutableDictionary dictionaryWithObject:@(NSKeyValueChangeSetting) forKey:NSKeyValueChangeKindKey];
+
+    if ( options & NSKeyValueObservingOptionNew ) {
+        change[NSKeyValueChangeNewKey] = [self readValueAndApply:^(id value) {}] ?: [NSNull null];
+    }
+
+    if ( options & NSKeyValueObservingOptionOld ) {
+        change[NSKeyValueChangeOldKey] = replacedValue ?: [NSNull null];
+    }
+
+    return change;
+}
+
+// must be called with the lock held
+- (void)unregister
+{
+    if ( _registeredObject != nil ) {
+        [self removeKVOObservation];
+        _registeredObject = nil;
+    }
+}
+
+- (void)removeKVOObservation
+{
+    // KVO throws an exception when removing an observer that was never added.
+    // This should never be a problem given how things are setup, but make sure to avoid a crash.
+    @try {
+        [_registeredObject removeObserver:self forKeyPath:_key context:kRZDBKVOContext];
+    }
+    @catch (__unused NSException *exception) {
+        RZDBLog(@"RZDataBinding attempted to remove an observer from object:%@, but the observer was never added. This shouldn't have happened, but won't affect anything going forward.", _registeredObject);
+    }
+}
+
+@end
+
+#pragma mark - Change merging
+
+// the keys of a change, so that KVO changes and RZDB change dicts are merged the same way
+typedef struct {
+    __unsafe_unretained NSString *kind;
+    __unsafe_unretained NSString *indexes;
+    __unsafe_unretained NSString *newValue;
+    __unsafe_unretained NSString *oldValue;
+} RZDBChangeKeys;
+
+// NO for to-many changes, including net changes of mixed kinds
+static inline BOOL rz_changeIsSetting(NSDictionary *change, RZDBChangeKeys keys)
+{
+    NSNumber *kind = change[keys.kind];
+
+    return ((kind == nil || kind.unsignedIntegerValue == NSKeyValueChangeSetting) && change[kRZDBChangeKeyRemovedIndexes] == nil);
+}
+
+// the rank-th index, counting from 0, that isn't in indexes
+static NSUInteger rz_indexSkippingIndexes(NSUInteger rank, NSIndexSet *indexes)
+{
+    __block NSUInteger index = rank;
+
+    [indexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        if ( idx <= index ) {
+            index++;
+        }
+        else {
+            *stop = YES;
+        }
+    }];
+
+    return index;
+}
+
+static void rz_addObjectsByIndex(NSMutableDictionary *objectsByIndex, NSArray *objects, NSIndexSet *indexes)
+{
+    __block NSUInteger position = 0;
+
+    [indexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        objectsByIndex[@(idx)] = objects[position++];
+    }];
+}
+
+// nil if objectsByIndex is nil or missing any of the indexes
+static NSArray* rz_objectsAtIndexes(NSDictionary *objectsByIndex, NSIndexSet *indexes)
+{
+    NSMutableArray *objects = (objectsByIndex != nil) ? [NSMutableArray arrayWithCapacity:indexes.count] : nil;
+
+    [indexes enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        id object = objectsByIndex[@(idx)];
+
+        if ( object != nil ) {
+            [objects addObject:object];
+        }
+        else {
+            [objects removeAllObjects];
+            *stop = YES;
+        }
+    }];
+
+    return (objects.count == indexes.count) ? objects : nil;
+}
+
+// describes a to-many change as the indexes it removes from the original collection and inserts into the final collection.
+// The object arrays are nil if the change doesn't include them.
+static void rz_getCollectionDiff(NSDictionary *change, RZDBChangeKeys keys, NSIndexSet **removed, NSArray **removedObjects, NSIndexSet **inserted, NSArray **insertedObjects)
+{
+    NSIndexSet *indexes = change[keys.indexes] ?: [NSIndexSet indexSet];
+
+    id newValue = change[keys.newValue];
+    id oldValue = change[keys.oldValue];
+
+    newValue = RZDBNotNull(newValue) ? newValue : nil;
+    oldValue = RZDBNotNull(oldValue) ? oldValue : nil;
+
+    switch ( [change[keys.kind] unsignedIntegerValue] ) {
+        case NSKeyValueChangeInsertion:
+            *removed = [NSIndexSet indexSet];
+            *removedObjects = @[];
+            *inserted = indexes;
+            *insertedObjects = newValue;
+            break;
+
+        case NSKeyValueChangeRemoval:
+            *removed = indexes;
+            *removedObjects = oldValue;
+            *inserted = [NSIndexSet indexSet];
+            *insertedObjects = @[];
+            break;
+
+        case NSKeyValueChangeReplacement:
+            *removed = indexes;
+            *removedObjects = oldValue;
+            *inserted = indexes;
+            *insertedObjects = newValue;
+            break;
+
+        default:
+            // a net change of mixed kinds, whose new value is the whole final collection
+            *removed = change[kRZDBChangeKeyRemovedIndexes];
+            *removedObjects = ((*removed).count == 0) ? @[] : nil;
+            *inserted = change[kRZDBChangeKeyInsertedIndexes];
+            *insertedObjects = [newValue isKindOfClass:[NSArray class]] ? [newValue objectsAtIndexes:*inserted] : nil;
+            break;
+    }
+}
+
+// composes two successive to-many changes into the single net change from the first one's original collection to the second one's final collection
+static NSDictionary* rz_mergeCollectionChanges(NSDictionary *pendingChange, NSDictionary *change, RZDBChangeKeys keys, id (^currentValue)(void))
+{
+    NSIndexSet *removed1, *inserted1, *removed2, *inserted2;
+    NSArray *removedObjects1, *insertedObjects1, *removedObjects2, *insertedObjects2;
+
+    rz_getCollectionDiff(pendingChange, keys, &removed1, &removedObjects1, &inserted1, &insertedObjects1);
+    rz_getCollectionDiff(change, keys, &removed2, &removedObjects2, &inserted2, &insertedObjects2);
+
+    NSMutableIndexSet *removed = [removed1 mutableCopy];
+    NSMutableIndexSet *inserted = [inserted2 mutableCopy];
+
+    NSMutableDictionary *removedObjects = (removedObjects1 != nil && removedObjects2 != nil) ? [NSMutableDictionary dictionary] : nil;
+    NSMutableDictionary *insertedObjects = (insertedObjects1 != nil && insertedObjects2 != nil) ? [NSMutableDictionary dictionary] : nil;
+
+    rz_addObjectsByIndex(removedObjects, removedObjects1, removed1);
+    rz_addObjectsByIndex(insertedObjects, insertedObjects2, inserted2);
+
+    // an object removed by the second change was either inserted by the first change, or is removed from the original collection
+    __block NSUInteger position = 0;
+
+    [removed2 enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        if ( ![inserted1 containsIndex:idx] ) {
+            NSUInteger originalIndex = rz_indexSkippingIndexes(idx - [inserted1 countOfIndexesInRange:NSMakeRange(0, idx)], removed1);
+
+            [removed addIndex:originalIndex];
+            removedObjects[@(originalIndex)] = removedObjects2[position];
+        }
+
+        position++;
+    }];
+
+    // an object inserted by the first change that survives the second change is shifted to its final index
+    position = 0;
+
+    [inserted1 enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL *stop) {
+        if ( ![removed2 containsIndex:idx] ) {
+            NSUInteger finalIndex = rz_indexSkippingIndexes(idx - [removed2 countOfIndexesInRange:NSMakeRange(0, idx)], inserted2);
+
+            [inserted addIndex:finalIndex];
+            insertedObjects[@(finalIndex)] = insertedObjects1[position];
+        }
+
+        position++;
+    }];
+
+    NSMutableDictionary *mergedChange = [change mutableCopy];
+    [mergedChange removeObjectsForKeys:@[keys.indexes, keys.newValue, keys.oldValue, kRZDBChangeKeyRemovedIndexes, kRZDBChangeKeyInsertedIndexes]];
+
+    if ( removed.count == 0 ) {
+        mergedChange[keys.kind] = @(NSKeyValueChangeInsertion);
+        mergedChange[keys.indexes] = [inserted copy];
+        mergedChange[keys.newValue] = rz_objectsAtIndexes(insertedObjects, inserted);
+    }
+    else if ( inserted.count == 0 ) {
+        mergedChange[keys.kind] = @(NSKeyValueChangeRemoval);
+        mergedChange[keys.indexes] = [removed copy];
+        mergedChange[keys.oldValue] = rz_objectsAtIndexes(removedObjects, removed);
+    }
+    else if ( [removed isEqualToIndexSet:inserted] ) {
+        mergedChange[keys.kind] = @(NSKeyValueChangeReplacement);
+        mergedChange[keys.indexes] = [inserted copy];
+        mergedChange[keys.newValue] = rz_objectsAtIndexes(insertedObjects, inserted);
+        mergedChange[keys.oldValue] = rz_objectsAtIndexes(removedObjects, removed);
+    }
+    else {
+        // no single kind describes both removals and insertions, so the whole collection is set along with the net edit
+        mergedChange[keys.kind] = @(NSKeyValueChangeSetting);
+        mergedChange[keys.newValue] = currentValue();
+        mergedChange[kRZDBChangeKeyRemovedIndexes] = [removed copy];
+        mergedChange[kRZDBChangeKeyInsertedIndexes] = [inserted copy];
+    }
+
+    return mergedChange;
+}
+
+// the latest new value wins, but the old value is the one from before the first pending change.
+// currentValue returns the value of the key path after change, and is only called when merging to-many changes.
+static NSDictionary* rz_mergeChanges(NSDictionary *pendingChange, NSDictionary *change, RZDBChangeKeys keys, id (^currentValue)(void))
+{
+    if ( pendingChange == nil ) {
+        return change;
+    }
+
+    BOOL pendingIsSetting = rz_changeIsSetting(pendingChange, keys);
+    BOOL isSetting = rz_changeIsSetting(change, keys);
+
+    if ( !pendingIsSetting && !isSetting ) {
+        return rz_mergeCollectionChanges(pendingChange, change, keys, currentValue);
+    }
+
+    NSMutableDictionary *mergedChange = [change mutableCopy];
+
+    if ( !isSetting ) {
+        // the pending change set the whole value, so the merged change does too
+        [mergedChange removeObjectsForKeys:@[keys.indexes, kRZDBChangeKeyRemovedIndexes, kRZDBChangeKeyInsertedIndexes]];
+
+        mergedChange[keys.kind] = pendingChange[keys.kind];
+        mergedChange[keys.newValue] = currentValue();
+    }
+
+    // the old value of a to-many change is only the removed objects, so it isn't the earlier value of the key path
+    mergedChange[keys.oldValue] = pendingIsSetting ? pendingChange[keys.oldValue] : nil;
+
+    return mergedChange;
+}
+
+// collection is the value of the key path after kvoChange, as returned by -[RZDBObserver collectionForKVOChange:]
+static NSDictionary* rz_mergeKVOChanges(NSDictionary *pendingChange, NSDictionary *kvoChange, id collection)
+{
+    RZDBChangeKeys keys = { NSKeyValueChangeKindKey, NSKeyValueChangeIndexesKey, NSKeyValueChangeNewKey, NSKeyValueChangeOldKey };
+
+    return rz_mergeChanges(pendingChange, kvoChange, keys, ^id {
+        return collection;
+    });
+}
+
+NSDictionary* rz_mergeChangeDicts(NSDictionary *pendingChange, NSDictionary *change)
+{
+    RZDBChangeKeys keys = { kRZDBChangeKeyKind, kRZDBChangeKeyIndexes, kRZDBChangeKeyNew, kRZDBChangeKeyOld };
+
+    // a coalesce merges changes on the thread that made them, so the current value can be read directly
+    return rz_mergeChanges(pendingChange, change, keys, ^id {
+        return [[change[kRZDBChangeKeyObject] valueForKeyPath:change[kRZDBChangeKeyKeyPath]] copy];
+    });
+}
+
+#pragma mark - RZDBDeliveryBatch implementation
+
+// batches that haven't started delivering yet, at most one per queue, keyed by the queue's address.
+// The tables are striped by queue address, so that changes delivered on different queues rarely contend.
+#define RZDB_BATCH_STRIPE_COUNT 16
+
+static NSMapTable *s_pendingBatches[RZDB_BATCH_STRIPE_COUNT];
+static pthread_mutex_t s_pendingBatchesLocks[RZDB_BATCH_STRIPE_COUNT];
+
+static inline NSUInteger rz_batchStripeForQueue(dispatch_queue_t queue)
+{
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        for ( NSUInteger i = 0; i < RZDB_BATCH_STRIPE_COUNT; i++ ) {
+            pthread_mutex_init(&s_pendingBatchesLocks[i], NULL);
+            s_pendingBatches[i] = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality
+                                                        valueOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality];
+        }
+    });
+
+    uintptr_t address = (uintptr_t)rz_dispatchAddress(queue);
+
+    return ((address >> 4) ^ (address >> 10)) & (RZDB_BATCH_STRIPE_COUNT - 1);
+}
+
+@implementation RZDBDeliveryBatch {
+    dispatch_queue_t _queue;
+
+    // observers in the order they first changed, and the latest change for each
+    NSMutableArray *_observers;
+    NSMapTable *_changesByObserver;
+
+    // the target of each observer, which may deallocate before the batch is delivered
+    NSMapTable *_targetsByObserver;
+}
+
++ (void)enqueueKVOChange:(NSDictionary *)kvoChange forObserver:(RZDBObserver *)observer
+{
+    dispatch_queue_t queue = observer.deliveryQueue;
+    RZDBDeliveryBatch *batch = nil;
+    BOOL schedule = NO;
+
+    // read before locking, since reading the collection calls out to the observed object
+    id collection = [observer collectionForKVOChange:kvoChange];
+
+    NSUInteger stripe = rz_batchStripeForQueue(queue);
+    NSMapTable *pendingBatches = s_pendingBatches[stripe];
+
+    pthread_mutex_lock(&s_pendingBatchesLocks[stripe]);
+
+    batch = [pendingBatches objectForKey:(__bridge id)rz_dispatchAddress(queue)];
+
+    if ( batch == nil ) {
+        batch = [[self alloc] initWithQueue:queue];
+        [pendingBatches setObject:batch forKey:(__bridge id)rz_dispatchAddress(queue)];
+
+        schedule = YES;
+    }
+
+    [batch addKVOChange:kvoChange forObserver:observer collection:collection];
+
+    pthread_mutex_unlock(&s_pendingBatchesLocks[stripe]);
+
+    // only the change that creates a batch schedules it. Later changes join it until it is delivered.
+    if ( schedule ) {
+        dispatch_async(queue, ^{
+            [batch deliver];
+        });
+    }
+}
+
+- (instancetype)initWithQueue:(dispatch_queue_t)queue
+{
+    self = [super init];
+    if ( self != nil ) {
+        _queue = queue;
+        rz_dispatchRetain(_queue);
+
+        _observers = [NSMutableArray array];
+        _changesByObserver = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                                   valueOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPersonality];
+        _targetsByObserver = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                                   valueOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality];
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    rz_dispatchRelease(_queue);
+}
+
+#pragma mark - private methods
+
+// must be called with the lock of the queue's stripe held
+- (void)addKVOChange:(NSDictionary *)kvoChange forObserver:(RZDBObserver *)observer collection:(id)collection
+{
+    NSDictionary *pendingChange = [_changesByObserver objectForKey:observer];
+
+    if ( pendingChange == nil ) {
+        [_observers addObject:observer];
+        [_targetsByObserver setObject:observer.target forKey:observer];
+    }
+
+    [_changesByObserver setObject:rz_mergeKVOChanges(pendingChange, kvoChange, collection) forKey:observer];
+}
+
+- (void)deliver
+{
+    NSUInteger stripe = rz_batchStripeForQueue(_queue);
+
+    pthread_mutex_lock(&s_pendingBatchesLocks[stripe]);
+
+    // changes made from here on start a new batch, so this batch can be read without the lock
+    [s_pendingBatches[stripe] removeObjectForKey:(__bridge id)rz_dispatchAddress(_queue)];
+
+    pthread_mutex_unlock(&s_pendingBatchesLocks[stripe]);
+
+    for ( RZDBObserver *observer in _observers ) {
+        [observer deliverDeferredKVOChange:[_changesByObserver objectForKey:observer] target:[_targetsByObserver objectForKey:observer]];
+    }
+}
+
+@end
+
+#pragma mark - RZDBRateLimiter implementation
+
+@implementation RZDBRateLimiter {
+    __weak RZDBObserver *_observer;
+
+    uint64_t _interval;
+    BOOL _debounce;
+
+    dispatch_queue_t _queue;
+    dispatch_source_t _timer;
+
+    pthread_mutex_t _lock;
+    NSDictionary *_pendingChange;
+
+    // the observer's target, which may deallocate before the pending change is delivered
+    __weak id _target;
+
+    // for throttling, YES from a delivery until the following interval has elapsed
+    BOOL _throttling;
+}
+
+- (instancetype)initWithObserver:(RZDBObserver *)observer interval:(NSTimeInterval)interval debounce:(BOOL)debounce queue:(dispatch_queue_t)queue
+{
+    self = [super init];
+    if ( self != nil ) {
+        _observer = observer;
+        _interval = (uint64_t)(interval * NSEC_PER_SEC);
+        _debounce = debounce;
+        _queue = queue ?: dispatch_get_main_queue();
+        rz_dispatchRetain(_queue);
+
+        pthread_mutex_init(&_lock, NULL);
+
+        // the timer is created disarmed, and is armed each time a change needs to be delivered later
+        _timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _queue);
+        dispatch_source_set_timer(_timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+
+        __weak RZDBRateLimiter *weakSelf = self;
+        dispatch_source_set_event_handler(_timer, ^{
+            [weakSelf timerFired];
+        });
+
+        dispatch_resume(_timer);
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    dispatch_source_cancel(_timer);
+    rz_dispatchRelease(_timer);
+    rz_dispatchRelease(_queue);
+
+    pthread_mutex_destroy(&_lock);
+}
+
+- (void)addKVOChange:(NSDictionary *)kvoChange
+{
+    NSDictionary *immediateChange = nil;
+
+    RZDBObserver *observer = _observer;
+    id target = observer.target;
+
+    // read before locking, since reading the collection calls out to the observed object
+    id collection = [observer collectionForKVOChange:kvoChange];
+
+    pthread_mutex_lock(&_lock);
+
+    _target = target;
+
+    if ( _debounce ) {
+        // every change restarts the interval
+        _pendingChange = rz_mergeKVOChanges(_pendingChange, kvoChange, collection);
+        [self armTimer];
+    }
+    else if ( !_throttling ) {
+        // the first change in an interval is delivered right away
+        _throttling = YES;
+        immediateChange = kvoChange;
+        [self armTimer];
+    }
+    else {
+        _pendingChange = rz_mergeKVOChanges(_pendingChange, kvoChange, collection);
+    }
+
+    pthread_mutex_unlock(&_lock);
+
+    if ( immediateChange != nil ) {
+        __weak id weakTarget = target;
+
+        dispatch_async(_queue, ^{
+            [observer deliverDeferredKVOChange:immediateChange target:weakTarget];
+        });
+    }
+}
+
+- (void)cancel
+{
+    pthread_mutex_lock(&_lock);
+
+    dispatch_source_cancel(_timer);
+    _pendingChange = nil;
+
+    pthread_mutex_unlock(&_lock);
+}
+
+#pragma mark - private methods
+
+// must be called with the lock held
+- (void)armTimer
+{
+    dispatch_source_set_timer(_timer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)_interval), DISPATCH_TIME_FOREVER, _interval / 10);
+}
+
+- (void)timerFired
+{
+    pthread_mutex_lock(&_lock);
+
+    NSDictionary *change = _pendingChange;
+    _pendingChange = nil;
+
+    id target = _target;
+
+    if ( change != nil && !_debounce ) {
+        // a throttled change delivered at the end of an interval starts the next interval
+        [self armTimer];
+    }
+    else {
+        _throttling = NO;
+        dispatch_source_set_timer(_timer, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+    }
+
+    pthread_mutex_unlock(&_lock);
+
+    if ( change != nil ) {
+        [_observer deliverDeferredKVOChange:change target:target];
+    }
+}
+
+@end
+
+#pragma mark - RZDBSuspension implementation
+
+@implementation RZDBSuspension {
+    // guarded by the suspended object's lock stripe
+    NSUInteger _suspendCount;
+
+    // observers in the order they first changed, and the latest change for each
+    NSMutableArray *_observers;
+    NSMapTable *_changesByObserver;
+}
+
++ (void)suspendObject:(id)object key:(const void *)key
+{
+    rz_lockObject(object);
+
+    RZDBSuspension *suspension = objc_getAssociatedObject(object, key);
+
+    if ( suspension == nil ) {
+        suspension = [[self alloc] init];
+        objc_setAssociatedObject(object, key, suspension, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+
+    suspension->_suspendCount++;
+
+    rz_unlockObject(object);
+}
+
++ (void)resumeObject:(id)object key:(const void *)key
+{
+    RZDBSuspension *resumed = nil;
+
+    rz_lockObject(object);
+
+    RZDBSuspension *suspension = objc_getAssociatedObject(object, key);
+
+    if ( suspension != nil && --suspension->_suspendCount == 0 ) {
+        // changes made from here on are delivered normally, so the suspension can be read without the lock
+        objc_setAssociatedObject(object, key, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        resumed = suspension;
+    }
+
+    rz_unlockObject(object);
+
+    if ( resumed == nil ) {
+        return;
+    }
+
+    for ( RZDBObserver *observer in resumed->_observers ) {
+        [observer notifyWithKVOChange:[resumed->_changesByObserver objectForKey:observer] sharedChange:nil];
+    }
+}
+
++ (BOOL)suspendKVOChange:(NSDictionary *)kvoChange forObserver:(RZDBObserver *)observer
+{
+    // a change is held by one suspension at a time. If both objects are suspended, the target holds it,
+    // and the observed object holds it again if it is still suspended when the target resumes.
+    return ([self addKVOChange:kvoChange forObserver:observer toObject:observer.target key:kRZDBTargetSuspensionKey] ||
+            [self addKVOChange:kvoChange forObserver:observer toObject:observer.observedObject key:kRZDBObjectSuspensionKey]);
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if ( self != nil ) {
+        _observers = [NSMutableArray array];
+        _changesByObserver = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality
+                                                   valueOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPersonality];
+
+        atomic_fetch_add_explicit(&kRZDBSuspensionCount, 1, memory_order_relaxed);
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    // a suspension lives until it resumes, or until its object is deallocated
+    atomic_fetch_sub_explicit(&kRZDBSuspensionCount, 1, memory_order_relaxed);
+}
+
+#pragma mark - private methods
+
++ (BOOL)addKVOChange:(NSDictionary *)kvoChange forObserver:(RZDBObserver *)observer toObject:(id)object key:(const void *)key
+{
+    if ( object == nil ) {
+        return NO;
+    }
+
+    rz_lockObject(object);
+    RZDBSuspension *suspension = objc_getAssociatedObject(object, key);
+    rz_unlockObject(object);
+
+    if ( suspension == nil ) {
+        return NO;
+    }
+
+    // read before locking, since reading the collection calls out to the observed object
+    id collection = [observer collectionForKVOChange:kvoChange];
+
+    rz_lockObject(object);
+
+    // the object may have resumed in the meantime, in which case the change is delivered right away
+    BOOL suspended = (objc_getAssociatedObject(object, key) == suspension);
+
+    if ( suspended ) {
+        NSDictionary *pendingChange = [suspension->_changesByObserver objectForKey:observer];
+
+        if ( pendingChange == nil ) {
+            [suspension->_observers addObject:observer];
+        }
+
+        [suspension->_changesByObserver setObject:rz_mergeKVOChanges(pendingChange, kvoChange, collection) forKey:observer];
+    }
+
+    rz_unlockObject(object);
+
+    return suspended;
+}
+
+@end
+
+#pragma mark - RZDBPropagation implementation
+
+// holds a +1 reference to the current thread's propagation, which is reused by every change on the thread
+static pthread_key_t kRZDBPropagationKey;
+
+static void rz_releasePropagation(void *propagation)
+{
+    CFRelease(propagation);
+}
 
-@end
+@implementation RZDBPropagation {
+    // the depth of nested fan outs. Work is only deferred while a change is fanning out.
+    NSUInteger _depth;
 
-#pragma mark - RZDataBinding implementation
+    // pending binding observers bucketed by the rank of their bound key, and the same observers for deduplication
+    NSMutableArray *_observersByRank;
+    NSHashTable *_pendingObservers;
 
-@implementation NSObject (RZDataBinding)
+    // deferred callbacks. This is the propagation's own coalesce, rather than the thread's, so that coalesced callbacks
+    // that aren't ordered are unaffected by a propagation.
+    RZDBCoalesce *_callbacks;
+}
 
-- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChange:(NSString *)keyPath
++ (void)initialize
 {
-    [self rz_addTarget:target action:action forKeyPathChange:keyPath callImmediately:NO];
+    if ( self == [RZDBPropagation class] ) {
+        pthread_key_create(&kRZDBPropagationKey, rz_releasePropagation);
+    }
 }
 
-- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChange:(NSString *)keyPath callImmediately:(BOOL)callImmediately
++ (void)begin
 {
-    NSParameterAssert(target);
-    NSParameterAssert(action);
-
-    NSKeyValueObservingOptions observationOptions = kNilOptions;
+    RZDBPropagation *propagation = [self currentPropagation];
 
-    if ( [target methodSignatureForSelector:action].numberOfArguments > 2 ) {
-        observationOptions |= NSKeyValueObservingOptionNew | NSKeyValueObservingOptionOld;
+    if ( propagation == nil ) {
+        propagation = [[self alloc] init];
+        pthread_setspecific(kRZDBPropagationKey, CFBridgingRetain(propagation));
     }
 
-    if ( callImmediately ) {
-        observationOptions |= NSKeyValueObservingOptionInitial;
+    propagation->_depth++;
+}
+
++ (void)commit
+{
+    RZDBPropagation *propagation = [self currentPropagation];
+
+    // the propagation stays open while it drains, so that the changes it makes are deferred and ordered too
+    @try {
+        if ( propagation->_depth == 1 ) {
+            [propagation drain];
+        }
     }
+    @finally {
+        [propagation end];
+    }
+}
 
-    [self rz_addTarget:target action:action boundKey:nil bindingTransform:nil forKeyPath:keyPath withOptions:observationOptions];
++ (void)abort
+{
+    [[self currentPropagation] end];
 }
 
-- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChanges:(NSArray *)keyPaths
++ (BOOL)enqueueBindingObserver:(RZDBObserver *)observer
 {
-    [self rz_addTarget:target action:action forKeyPathChanges:keyPaths callImmediately:NO];
+    RZDBPropagation *propagation = [self currentPropagation];
+
+    if ( propagation == nil || propagation->_depth == 0 ) {
+        return NO;
+    }
+
+    [propagation addObserver:observer];
+
+    return YES;
 }
 
-- (void)rz_addTarget:(id)target action:(SEL)action forKeyPathChanges:(NSArray *)keyPaths callImmediately:(BOOL)callImmediately
++ (BOOL)deferTarget:(id)target action:(SEL)action change:(NSDictionary *)change
 {
-    BOOL callMultiple = NO;
+    RZDBPropagation *propagation = [self currentPropagation];
 
-    if ( callImmediately ) {
-        callMultiple = [target methodSignatureForSelector:action].numberOfArguments > 2;
+    if ( propagation == nil || propagation->_depth == 0 ) {
+        return NO;
     }
 
-    [keyPaths enumerateObjectsUsingBlock:^(NSString *keyPath, NSUInteger idx, BOOL *stop) {
-        [self rz_addTarget:target action:action forKeyPathChange:keyPath callImmediately:callMultiple];
-    }];
+    [propagation->_callbacks rz_deferTarget:target action:action change:change];
+
+    return YES;
+}
+
+#pragma mark - private methods
+
++ (RZDBPropagation *)currentPropagation
+{
+    return (__bridge RZDBPropagation *)pthread_getspecific(kRZDBPropagationKey);
+}
 
-    if ( callImmediately && !callMultiple ) {
-        ((void(*)(id, SEL))objc_msgSend)(target, action);
+- (instancetype)init
+{
+    self = [super init];
+    if ( self != nil ) {
+        _observersByRank = [NSMutableArray array];
+        _pendingObservers = [NSHashTable hashTableWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality];
+        _callbacks = [RZDBCoalesce rz_detachedCoalesce];
     }
+
+    return self;
 }
 
-- (void)rz_removeTarget:(id)target action:(SEL)action forKeyPathChange:(NSString *)keyPath
+// closes one level of fan out. If the outermost level ends without draining (e.g. because a callback raised),
+// whatever is still pending is discarded, so that it isn't sent by some later unrelated change.
+- (void)end
 {
-    [self rz_removeTarget:target action:action boundKey:nil forKeyPath:keyPath];
+    _depth--;
+
+    if ( _depth == 0 && (_pendingObservers.count > 0 || [_callbacks rz_hasNotifications]) ) {
+        [_observersByRank removeAllObjects];
+        [_pendingObservers removeAllObjects];
+        _callbacks = [RZDBCoalesce rz_detachedCoalesce];
+    }
 }
 
-- (void)rz_bindKey:(NSString *)key toKeyPath:(NSString *)foreignKeyPath ofObject:(id)object
+- (void)addObserver:(RZDBObserver *)observer
 {
-    [self rz_bindKey:key toKeyPath:foreignKeyPath ofObject:object withTransform:nil];
+    if ( [_pendingObservers containsObject:observer] ) {
+        return;
+    }
+
+    NSUInteger rank = rz_bindingRank(observer.target, observer.boundKey);
+
+    while ( _observersByRank.count <= rank ) {
+        [_observersByRank addObject:[NSMutableArray array]];
+    }
+
+    [_observersByRank[rank] addObject:observer];
+    [_pendingObservers addObject:observer];
 }
 
-- (void)rz_bindKey:(NSString *)key toKeyPath:(NSString *)foreignKeyPath ofObject:(id)object withTransform:(RZDBKeyBindingTransform)bindingTransform
+- (RZDBObserver *)nextObserver
 {
-    NSParameterAssert(key);
-    NSParameterAssert(foreignKeyPath);
-    
-    if ( object != nil ) {
-        @try {
-            id val = [object valueForKeyPath:foreignKeyPath];
+    for ( NSMutableArray *observers in _observersByRank ) {
+        if ( observers.count > 0 ) {
+            RZDBObserver *observer = observers.firstObject;
 
-            [self rz_setBoundKey:key withValue:val transform:bindingTransform];
-        }
-        @catch (NSException *exception) {
-            [NSException raise:NSInvalidArgumentException format:@"RZDataBinding cannot bind key:%@ to key path:%@ of object:%@. Reason: %@", key, foreignKeyPath, [object description], exception.reason];
+            [observers removeObjectAtIndex:0];
+            [_pendingObservers removeObject:observer];
+
+            return observer;
         }
-        
-        [object rz_addTarget:self action:@selector(rz_observeBoundKeyChange:) boundKey:key bindingTransform:bindingTransform forKeyPath:foreignKeyPath withOptions:NSKeyValueObservingOptionNew];
     }
+
+    return nil;
 }
 
-- (void)rz_unbindKey:(NSString *)key fromKeyPath:(NSString *)foreignKeyPath ofObject:(id)object
+- (void)drain
 {
-    [object rz_removeTarget:self action:@selector(rz_observeBoundKeyChange:) boundKey:key forKeyPath:foreignKeyPath];
+    // the lowest rank is always set first, so each binding is set after every ordered binding it depends on. Setting bindings
+    // may enqueue more bindings and callbacks, and sending callbacks may change more key paths, so repeat until nothing is pending.
+    do {
+        RZDBObserver *observer = nil;
+
+        while ( (observer = [self nextObserver]) != nil ) {
+            [observer applyCurrentValue];
+        }
+    } while ( [_callbacks rz_sendNotifications] || _pendingObservers.count > 0 );
 }
 
 @end
 
-#pragma mark - RZDataBinding_Private implementation
-
-@implementation NSObject (RZDataBinding_Private)
-
-- (void)rz_addTarget:(id)target action:(SEL)action boundKey:(NSString *)boundKey bindingTransform:(RZDBKeyBindingTransform)bindingTransform forKeyPath:(NSString *)keyPath withOptions:(NSKeyValueObservingOptions)options
+BOOL rz_deferPropagatingCallback(id target, SEL action, NSDictionary *change)
 {
-    RZDBObserverContainer *registeredObservers = nil;
-    RZDBObserverContainer *dependentObservers = nil;
+    return [RZDBPropagation deferTarget:target action:action change:change];
+}
+
+#pragma mark - RZDBObserverContainer implementation
 
-    RZDBObserver *observer = [[RZDBObserver alloc] initWithObservedObject:self keyPath:keyPath observationOptions:options];
+@implementation RZDBObserverContainer {
+    pthread_mutex_t _lock;
+    NSPointerFunctionsOptions _observerOptions;
 
-    [observer setTarget:target action:action boundKey:boundKey bindingTransform:bindingTransform];
+    // keyPath -> (target -> observers)
+    NSMutableDictionary *_observersByKeyPath;
 
-    @synchronized (self) {
-        registeredObservers = rz_registeredObservers(self);
+    // buckets created since empty buckets were last swept, and the number to create before sweeping again
+    NSUInteger _bucketsSinceSweep;
+    NSUInteger _sweepThreshold;
+}
 
-        if ( registeredObservers == nil ) {
-            registeredObservers = [RZDBObserverContainer strongContainer];
-            rz_setRegisteredObservers(self, registeredObservers);
-        }
-    }
++ (instancetype)strongContainer
+{
+    return [[self alloc] initWithObserverOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality];
+}
 
-    [registeredObservers addObserver:observer];
++ (instancetype)weakContainer
+{
+    // observers are owned by their observed object's container, which may be deallocated (e.g. without automatic cleanup)
+    // while the target's container still references them
+    return [[self alloc] initWithObserverOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality];
+}
 
-    @synchronized (target) {
-        dependentObservers = rz_dependentObservers(target);
+- (instancetype)initWithObserverOptions:(NSPointerFunctionsOptions)observerOptions
+{
+    self = [super init];
+    if ( self != nil ) {
+        _observerOptions = observerOptions;
+        _observersByKeyPath = [NSMutableDictionary dictionary];
 
-        if ( dependentObservers == nil ) {
-            dependentObservers = [RZDBObserverContainer weakContainer];
-            rz_setDependentObservers(target, dependentObservers);
-        }
+        rz_initRecursiveMutex(&_lock);
     }
+    return self;
+}
 
-    [dependentObservers addObserver:observer];
+- (void)dealloc
+{
+    pthread_mutex_destroy(&_lock);
+}
 
-#if RZDB_AUTOMATIC_CLEANUP
-    rz_swizzleDeallocIfNeeded([self class]);
-    rz_swizzleDeallocIfNeeded([target class]);
-#endif
+- (void)addObserver:(RZDBObserver *)observer
+{
+    pthread_mutex_lock(&_lock);
+    [self addObserverLocked:observer];
+    pthread_mutex_unlock(&_lock);
 }
 
-- (void)rz_removeTarget:(id)target action:(SEL)action boundKey:(NSString *)boundKey forKeyPath:(NSString *)keyPath
+- (void)addObservers:(NSArray *)observers
 {
-    [rz_registeredObservers(self) enumerateObserversUsingBlock:^(RZDBObserver *observer, BOOL *stop) {
-        BOOL targetsEqual   = (target == observer.target);
-        BOOL actionsEqual   = (action == NULL || action == observer.action);
-        BOOL boundKeysEqual = (boundKey == observer.boundKey || [boundKey isEqualToString:observer.boundKey]);
-        BOOL keyPathsEqual  = [keyPath isEqualToString:observer.keyPath];
+    pthread_mutex_lock(&_lock);
+
+    for ( RZDBObserver *observer in observers ) {
+        [self addObserverLocked:observer];
+    }
 
-        BOOL allEqual = (targetsEqual && actionsEqual && boundKeysEqual && keyPathsEqual);
+    pthread_mutex_unlock(&_lock);
+}
 
-        if ( allEqual ) {
-            [observer invalidate];
-        }
-    }];
+- (void)removeObserver:(RZDBObserver *)observer
+{
+    pthread_mutex_lock(&_lock);
+    [self removeObserverLocked:observer];
+    pthread_mutex_unlock(&_lock);
 }
 
-- (void)rz_observeBoundKeyChange:(NSDictionary *)change
+- (void)removeObservers:(NSArray *)observers
 {
-    NSString *boundKey = change[kRZDBChangeKeyBoundKey];
-    
-    if ( boundKey != nil ) {
-        id value = change[kRZDBChangeKeyNew];
+    pthread_mutex_lock(&_lock);
 
-        [self rz_setBoundKey:boundKey withValue:value transform:change[kRZDBChangeKeyBindingTransformKey]];
+    for ( RZDBObserver *observer in observers ) {
+        [self removeObserverLocked:observer];
     }
+
+    pthread_mutex_unlock(&_lock);
 }
 
-- (void)rz_setBoundKey:(NSString *)key withValue:(id)value transform:(RZDBKeyBindingTransform)transform
+- (NSArray *)observersForKeyPath:(NSString *)keyPath target:(id)target
 {
-    id currentValue = [self valueForKey:key];
+    pthread_mutex_lock(&_lock);
 
-    if ( transform != nil ) {
-        value = transform(value);
-    }
+    NSMapTable *observersByTarget = _observersByKeyPath[keyPath];
+    NSArray *observers = [[observersByTarget objectForKey:target] allObjects];
 
-    if ( currentValue != value && ![currentValue isEqual:value] ) {
-        [self setValue:value forKey:key];
+    if ( observersByTarget != nil && observers.count == 0 ) {
+        [self pruneObserversByTarget:observersByTarget forKeyPath:keyPath];
     }
+
+    pthread_mutex_unlock(&_lock);
+
+    return observers;
 }
 
-- (void)rz_cleanupObservers
+- (NSArray *)observersForKeyPath:(NSString *)keyPath
 {
-    [rz_registeredObservers(self) enumerateObserversUsingBlock:^(RZDBObserver *obs, BOOL *stop) {
-        [obs invalidate];
-    }];
+    NSMutableArray *allObservers = [NSMutableArray array];
+    BOOL prune = NO;
 
-    [rz_dependentObservers(self) enumerateObserversUsingBlock:^(RZDBObserver *obs, BOOL *stop) {
-        [obs invalidate];
-    }];
-}
+    pthread_mutex_lock(&_lock);
 
-@end
+    NSMapTable *observersByTarget = _observersByKeyPath[keyPath];
 
-#pragma mark - RZDBObserver implementation
+    for ( NSHashTable *observers in [observersByTarget objectEnumerator] ) {
+        NSArray *liveObservers = [observers allObjects];
 
-@implementation RZDBObserver
+        [allObservers addObjectsFromArray:liveObservers];
+        prune = prune || (liveObservers.count == 0);
+    }
 
-- (instancetype)initWithObservedObject:(NSObject *)observedObject keyPath:(NSString *)keyPath observationOptions:(NSKeyValueObservingOptions)observingOptions
-{
-    self = [super init];
-    if ( self != nil ) {
-        _observedObject = observedObject;
-        _keyPath = keyPath;
-        _observationOptions = observingOptions;
+    if ( prune ) {
+        [self pruneObserversByTarget:observersByTarget forKeyPath:keyPath];
     }
-    
-    return self;
+
+    pthread_mutex_unlock(&_lock);
+
+    return allObservers;
 }
 
-- (void)setTarget:(id)target action:(SEL)action boundKey:(NSString *)boundKey bindingTransform:(RZDBKeyBindingTransform)bindingTransform
+- (NSArray *)removeAllObservers
 {
-    self.target = target;
-    self.action = action;
-    self.methodSignature = [target methodSignatureForSelector:action];
+    NSMutableArray *allObservers = [NSMutableArray array];
 
-    self.boundKey = boundKey;
-    self.bindingTransform = bindingTransform;
+    pthread_mutex_lock(&_lock);
+
+    for ( NSMapTable *observersByTarget in [_observersByKeyPath objectEnumerator] ) {
+        for ( NSHashTable *observers in [observersByTarget objectEnumerator] ) {
+            [allObservers addObjectsFromArray:[observers allObjects]];
+        }
+    }
+
+    [_observersByKeyPath removeAllObjects];
 
-    [self.observedObject addObserver:self forKeyPath:self.keyPath options:self.observationOptions context:kRZDBKVOContext];
+    pthread_mutex_unlock(&_lock);
+
+    return allObservers;
 }
 
-- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary *)change context:(void *)context
+#pragma mark - private methods
+
+// must be called with the container's lock held
+- (void)removeObserverLocked:(RZDBObserver *)observer
 {
-    if ( context == kRZDBKVOContext ) {
-        id target = nil;
-        SEL action = NULL;
-        NSDictionary *changeDict = nil;
+    NSMapTable *observersByTarget = _observersByKeyPath[observer.keyPath];
+    NSHashTable *observers = [observersByTarget objectForKey:observer.target];
 
-        @synchronized (self) {
-            target = self.target;
-            action = self.action;
+    [observers removeObject:observer];
 
-            if ( self.methodSignature.numberOfArguments > 2 ) {
-                changeDict = [self changeDictForKVOChange:change];
-            }
-        }
+    // drop empty buckets so that churning registrations don't grow the index.
+    // count may include observers that have been zeroed out of a weak table, but anyObject doesn't.
+    if ( observers != nil && [observers anyObject] == nil ) {
+        [observersByTarget removeObjectForKey:observer.target];
 
-        if ( changeDict != nil ) {
-            ((void(*)(id, SEL, NSDictionary *))objc_msgSend)(target, action, changeDict);
-        }
-        else {
-            ((void(*)(id, SEL))objc_msgSend)(target, action);
+        if ( observersByTarget.count == 0 ) {
+            [_observersByKeyPath removeObjectForKey:observer.keyPath];
         }
     }
 }
 
-- (NSDictionary *)changeDictForKVOChange:(NSDictionary *)kvoChange
+// must be called with the container's lock held
+- (void)addObserverLocked:(RZDBObserver *)observer
 {
-    NSMutableDictionary *changeDict = [NSMutableDictionary dictionary];
-    
-    if ( self.observedObject != nil ) {
-        changeDict[kRZDBChangeKeyObject] = self.observedObject;
-    }
-    
-    if ( RZDBNotNull(kvoChange[NSKeyValueChangeOldKey]) ) {
-        changeDict[kRZDBChangeKeyOld] = kvoChange[NSKeyValueChangeOldKey];
+    NSMapTable *observersByTarget = _observersByKeyPath[observer.keyPath];
+
+    if ( observersByTarget == nil ) {
+        // targets are keyed by address only, so they are neither retained nor messaged
+        observersByTarget = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality
+                                                  valueOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPersonality];
+        _observersByKeyPath[observer.keyPath] = observersByTarget;
     }
-    
-    if ( RZDBNotNull(kvoChange[NSKeyValueChangeNewKey]) ) {
-        changeDict[kRZDBChangeKeyNew] = kvoChange[NSKeyValueChangeNewKey];
+
+    NSHashTable *observers = [observersByTarget objectForKey:observer.target];
+
+    if ( observers == nil ) {
+        // observers freed without being removed (e.g. from a weak container) leave empty buckets under dead target addresses.
+        // Sweeping once as many buckets have been created as remained after the last sweep keeps them bounded at amortized constant cost.
+        if ( ++_bucketsSinceSweep >= MAX(_sweepThreshold, (NSUInteger)8) ) {
+            [self pruneObserversByTarget:observersByTarget forKeyPath:nil];
+
+            _bucketsSinceSweep = 0;
+            _sweepThreshold = observersByTarget.count;
+        }
+
+        observers = [NSHashTable hashTableWithOptions:_observerOptions];
+        [observersByTarget setObject:observers forKey:observer.target];
     }
-    
-    if ( self.keyPath != nil ) {
-        changeDict[kRZDBChangeKeyKeyPath] = self.keyPath;
+
+    [observers addObject:observer];
+}
+
+// removes the buckets of targets whose observers have all been freed or removed, and the key path's entry
+// if no buckets remain and a key path is given. Must be called with the container's lock held.
+- (void)pruneObserversByTarget:(NSMapTable *)observersByTarget forKeyPath:(NSString *)keyPath
+{
+    NSMutableArray *emptyTargets = [NSMutableArray array];
+
+    // targets are only addresses, so they must not be retained
+    for ( __unsafe_unretained id target in observersByTarget ) {
+        if ( [[observersByTarget objectForKey:target] anyObject] == nil ) {
+            [emptyTargets addObject:[NSValue valueWithPointer:(__bridge const void *)target]];
+        }
     }
-    
-    if ( self.boundKey != nil ) {
-        changeDict[kRZDBChangeKeyBoundKey] = self.boundKey;
+
+    for ( NSValue *target in emptyTargets ) {
+        [observersByTarget removeObjectForKey:(__bridge id)target.pointerValue];
     }
-    
-    if ( self.bindingTransform != nil ) {
-        changeDict[kRZDBChangeKeyBindingTransformKey] = self.bindingTransform;
+
+    if ( keyPath != nil && observersByTarget.count == 0 ) {
+        [_observersByKeyPath removeObjectForKey:keyPath];
     }
-    
-    return [changeDict copy];
 }
 
-- (void)invalidate
-{
-    id observedObject = self.observedObject;
+@end
 
-    [rz_dependentObservers(self.target) removeObserver:self];
-    [rz_registeredObservers(observedObject) removeObserver:self];
+NSString* rz_internString(NSString *string)
+{
+    static NSHashTable *s_internedStrings = nil;
+    static pthread_mutex_t s_internedStringsLock = PTHREAD_MUTEX_INITIALIZER;
 
-    // KVO throws an exception when removing an observer that was never added.
-    // This should never be a problem given how things are setup, but make sure to avoid a crash.
-    @try {
-        [observedObject removeObserver:self forKeyPath:self.keyPath context:kRZDBKVOContext];
+    if ( string == nil ) {
+        return nil;
     }
-    @catch (__unused NSException *exception) {
-        RZDBLog(@"RZDataBinding attempted to remove an observer from object:%@, but the observer was never added. This shouldn't have happened, but won't affect anything going forward.", observedObject);
+
+    pthread_mutex_lock(&s_internedStringsLock);
+
+    if ( s_internedStrings == nil ) {
+        s_internedStrings = [NSHashTable hashTableWithOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPersonality];
     }
 
-    @synchronized (self) {
-        self.observedObject = nil;
-        self.target = nil;
-        self.action = NULL;
-        self.methodSignature = nil;
+    NSString *interned = [s_internedStrings member:string];
+
+    if ( interned == nil ) {
+        interned = [string copy];
+        [s_internedStrings addObject:interned];
     }
+
+    pthread_mutex_unlock(&s_internedStringsLock);
+
+    return interned;
 }
 
-@end
+// Lock stripes are padded to a cache line, so that threads locking neighboring stripes don't false share.
+#define RZDB_LOCK_STRIPE_COUNT 64
 
-#pragma mark - RZDBObserverContainer implementation
+typedef struct {
+    pthread_mutex_t mutex;
+} __attribute__((aligned(64))) RZDBLockStripe;
 
-@implementation RZDBObserverContainer {
-    NSHashTable *_observers;
+static RZDBLockStripe kRZDBLockStripes[RZDB_LOCK_STRIPE_COUNT];
+
+void rz_initRecursiveMutex(pthread_mutex_t *mutex)
+{
+    // recursive, so that callouts made while locked (e.g. a dealloc that cleans up observers) can re-enter safely
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+
+    pthread_mutex_init(mutex, &attributes);
+
+    pthread_mutexattr_destroy(&attributes);
 }
 
-+ (instancetype)strongContainer
+static inline pthread_mutex_t* rz_lockStripeForObject(__unsafe_unretained id object)
 {
-    return [[self alloc] initWithBackingStore:[NSHashTable hashTableWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPersonality]];
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        for ( NSUInteger i = 0; i < RZDB_LOCK_STRIPE_COUNT; i++ ) {
+            rz_initRecursiveMutex(&kRZDBLockStripes[i].mutex);
+        }
+    });
+
+    uintptr_t address = (uintptr_t)(__bridge void *)object;
+
+    // objects are 16 byte aligned, so mix in higher bits to spread neighboring allocations
+    return &kRZDBLockStripes[((address >> 4) ^ (address >> 10)) & (RZDB_LOCK_STRIPE_COUNT - 1)].mutex;
 }
 
-+ (instancetype)weakContainer
+void rz_lockObject(__unsafe_unretained id object)
 {
-    return [[self alloc] initWithBackingStore:[NSHashTable weakObjectsHashTable]];
+    pthread_mutex_lock(rz_lockStripeForObject(object));
 }
 
-- (instancetype)initWithBackingStore:(NSHashTable *)backingStore
+void rz_unlockObject(__unsafe_unretained id object)
 {
-    self = [super init];
-    if ( self != nil ) {
-        _observers = backingStore;
-    }
-    return self;
+    pthread_mutex_unlock(rz_lockStripeForObject(object));
 }
 
-- (void)addObserver:(RZDBObserver *)observer
+// sel_getUid, because ARC forbids @selector(dealloc)
+static SEL rz_deallocSelector(void)
 {
-    @synchronized (self) {
-        [_observers addObject:observer];
-    }
+    static SEL deallocSEL = NULL;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        deallocSEL = sel_getUid("dealloc");
+    });
+
+    return deallocSEL;
 }
 
-- (void)removeObserver:(RZDBObserver *)observer
+// An insert-only, open addressing hash map from classes whose dealloc swizzling is resolved to the dealloc IMP
+// they resolved at the time. Slots are read and written atomically, so lookups need no lock. If the map fills up,
+// further classes simply aren't cached, and take the slow path in rz_swizzleDeallocIfNeeded.
+// A class's address can be reused once its class pair is disposed, so an entry only counts while the class at
+// that address still resolves the same dealloc IMP. A new class at a reused address takes the slow path,
+// which then replaces the IMP in the existing slot.
+#define RZDB_DEALLOC_SWIZZLE_CACHE_SIZE 4096
+#define RZDB_DEALLOC_SWIZZLE_CACHE_MAX_PROBES 32
+
+static atomic_uintptr_t kRZDBDeallocSwizzleCache[RZDB_DEALLOC_SWIZZLE_CACHE_SIZE];
+static atomic_uintptr_t kRZDBDeallocSwizzleCacheIMPs[RZDB_DEALLOC_SWIZZLE_CACHE_SIZE];
+
+static inline NSUInteger rz_deallocSwizzleCacheIndex(uintptr_t key)
 {
-    @synchronized (self) {
-        [_observers removeObject:observer];
-    }
+    // classes are at least 8 byte aligned, so discard the low bits before mixing
+    return (NSUInteger)(((key >> 3) * 2654435761u) & (RZDB_DEALLOC_SWIZZLE_CACHE_SIZE - 1));
 }
 
-- (void)enumerateObserversUsingBlock:(void (^)(RZDBObserver *, BOOL *))block
+BOOL rz_deallocSwizzleCacheContains(Class class)
 {
-    @synchronized (self) {
-        NSHashTable *observers = ^{
-            @synchronized (self->_observers) {
-                return [self->_observers copy];
-            }
-        }();
+    uintptr_t key = (uintptr_t)(__bridge void *)class;
+    NSUInteger idx = rz_deallocSwizzleCacheIndex(key);
 
-        BOOL stop = NO;
-        for ( RZDBObserver *observer in observers ) {
-            if ( observer != nil ) {
-                block(observer, &stop);
-            }
+    for ( NSUInteger i = 0; i < RZDB_DEALLOC_SWIZZLE_CACHE_MAX_PROBES; i++ ) {
+        uintptr_t slot = atomic_load_explicit(&kRZDBDeallocSwizzleCache[idx], memory_order_acquire);
 
-            if ( stop ) {
-                break;
-            }
+        if ( slot == key ) {
+            uintptr_t imp = atomic_load_explicit(&kRZDBDeallocSwizzleCacheIMPs[idx], memory_order_acquire);
+
+            return (imp != 0 && imp == (uintptr_t)class_getMethodImplementation(class, rz_deallocSelector()));
+        }
+        else if ( slot == 0 ) {
+            return NO;
         }
+
+        idx = (idx + 1) & (RZDB_DEALLOC_SWIZZLE_CACHE_SIZE - 1);
     }
+
+    return NO;
 }
 
-@end
+void rz_deallocSwizzleCacheInsert(Class class)
+{
+    uintptr_t key = (uintptr_t)(__bridge void *)class;
+    uintptr_t imp = (uintptr_t)class_getMethodImplementation(class, rz_deallocSelector());
+    NSUInteger idx = rz_deallocSwizzleCacheIndex(key);
+
+    for ( NSUInteger i = 0; i < RZDB_DEALLOC_SWIZZLE_CACHE_MAX_PROBES; i++ ) {
+        uintptr_t expected = 0;
+
+        if ( atomic_compare_exchange_strong_explicit(&kRZDBDeallocSwizzleCache[idx], &expected, key, memory_order_release, memory_order_relaxed) || expected == key ) {
+            atomic_store_explicit(&kRZDBDeallocSwizzleCacheIMPs[idx], imp, memory_order_release);
+            return;
+        }
+
+        idx = (idx + 1) & (RZDB_DEALLOC_SWIZZLE_CACHE_SIZE - 1);
+    }
+}
 
-// a class doesn't need dealloc swizzled if it or a superclass has been swizzled already
+// a class doesn't need dealloc swizzled if it or a superclass has been swizzled already.
+// The swizzled dealloc IMP is stored with each swizzled class, so that a stale flag left at a reused address doesn't count.
 BOOL rz_requiresDeallocSwizzle(Class class)
 {
     BOOL swizzled = NO;
 
     for ( Class currentClass = class; !swizzled && currentClass != nil; currentClass = class_getSuperclass(currentClass) ) {
-        swizzled = [objc_getAssociatedObject(currentClass, kRZDBSwizzledDeallocKey) boolValue];
+        NSValue *swizzledIMP = objc_getAssociatedObject(currentClass, kRZDBSwizzledDeallocKey);
+
+        swizzled = (swizzledIMP != nil && swizzledIMP.pointerValue == (void *)class_getMethodImplementation(currentClass, rz_deallocSelector()));
     }
 
     return !swizzled;
@@ -481,22 +3670,28 @@ BOOL rz_requiresDeallocSwizzle(Class class)
 // that are used in RZDataBinding.
 void rz_swizzleDeallocIfNeeded(Class class)
 {
-    static SEL deallocSEL = NULL;
     static SEL cleanupSEL = NULL;
 
+    // the common case, after the first registration for a class
+    if ( rz_deallocSwizzleCacheContains(class) ) {
+        return;
+    }
+
     static dispatch_once_t onceToken;
     dispatch_once(&onceToken, ^{
-        deallocSEL = sel_getUid("dealloc");
         cleanupSEL = sel_getUid("rz_cleanupObservers");
     });
 
-    @synchronized (class) {
-        if ( !rz_requiresDeallocSwizzle(class) ) {
-            // dealloc swizzling already resolved
-            return;
-        }
+    SEL deallocSEL = rz_deallocSelector();
 
-        objc_setAssociatedObject(class, kRZDBSwizzledDeallocKey, @(YES), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    // held until the swizzled IMP is stored, so that no other thread sees the class as swizzled before it is
+    rz_lockObject(class);
+
+    if ( !rz_requiresDeallocSwizzle(class) ) {
+        // dealloc swizzling already resolved
+        rz_deallocSwizzleCacheInsert(class);
+        rz_unlockObject(class);
+        return;
     }
 
     Method dealloc = NULL;
@@ -514,11 +3709,13 @@ void rz_swizzleDeallocIfNeeded(Class class)
 
     free(methods);
 
+    IMP swizzledIMP = NULL;
+
     if ( dealloc == NULL ) {
         Class superclass = class_getSuperclass(class);
 
         // class does not implement dealloc, so implement it directly
-        class_addMethod(class, deallocSEL, imp_implementationWithBlock(^(__unsafe_unretained id self) {
+        swizzledIMP = imp_implementationWithBlock(^(__unsafe_unretained id self) {
 
             // cleanup RZDB observers
             ((void(*)(id, SEL))objc_msgSend)(self, cleanupSEL);
@@ -528,16 +3725,36 @@ void rz_swizzleDeallocIfNeeded(Class class)
             struct objc_super superStruct = (struct objc_super){ self, superclass };
             ((void (*)(struct objc_super*, SEL))objc_msgSendSuper)(&superStruct, deallocSEL);
 
-        }), method_getTypeEncoding(dealloc));
+        });
+
+        class_addMethod(class, deallocSEL, swizzledIMP, method_getTypeEncoding(dealloc));
     }
     else {
         // class implements dealloc, so extend the existing implementation
-        __block IMP deallocIMP = method_setImplementation(dealloc, imp_implementationWithBlock(^(__unsafe_unretained id self) {
+        IMP deallocIMP = method_getImplementation(dealloc);
+
+        swizzledIMP = imp_implementationWithBlock(^(__unsafe_unretained id self) {
             // cleanup RZDB observers
             ((void(*)(id, SEL))objc_msgSend)(self, cleanupSEL);
 
             // invoke the original dealloc IMP
             ((void(*)(id, SEL))deallocIMP)(self, deallocSEL);
-        }));
+        });
+
+        method_setImplementation(dealloc, swizzledIMP);
     }
+
+    objc_setAssociatedObject(class, kRZDBSwizzledDeallocKey, [NSValue valueWithPointer:(void *)swizzledIMP], OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+
+    rz_unlockObject(class);
+
+    // only cache the class once its dealloc is actually swizzled
+    rz_deallocSwizzleCacheInsert(class);
+}
+
+void rz_invalidateCallbackCache(void)
+{
+    atomic_fetch_add_explicit(&kRZDBCallbackGeneration, 1, memory_order_release);
+
+    rz_invalidateKeyPathCache();
 }
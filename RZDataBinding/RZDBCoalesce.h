@@ -46,6 +46,8 @@
  *  The proxy will treat any 0-arg or 1-dictionary-arg methods with void return type as RZDB callbacks,
  *  and coalesce them accordingly.
  *
+ *  @note Registering with RZDBObservationOptionCoalesce is equivalent and faster, because it avoids message forwarding.
+ *
  *  @see RZDBCoalesce for how to begin/end coalesce events.
  *
  *  @return A proxy object to use as a data binding target in the rz_addTarget:action: methods.
@@ -28,12 +28,26 @@
 
 #import <objc/runtime.h>
 #import <objc/message.h>
+#import <pthread.h>
 
 #import "RZDBCoalesce.h"
 
 #import "NSObject+RZDataBinding.h"
 
-static NSString* const kRZDBCoalesceStorageKey = @"RZDBCoalesce";
+// holds a +1 reference to the current thread's active coalesce, if any
+static pthread_key_t kRZDBCoalesceKey;
+
+// implemented in NSObject+RZDataBinding.m
+OBJC_EXTERN void rz_lockObject(__unsafe_unretained id object);
+OBJC_EXTERN void rz_unlockObject(__unsafe_unretained id object);
+OBJC_EXTERN NSDictionary* rz_mergeChangeDicts(NSDictionary *pendingChange, NSDictionary *change);
+
+#if RZDB_INSTRUMENTATION
+// implemented in RZDBInstrumentation.m
+OBJC_EXTERN uint64_t rz_instrumentationTime(void);
+OBJC_EXTERN void rz_recordCoalescedNotification(void);
+OBJC_EXTERN void rz_recordCoalescedDelivery(id target, SEL action, uint64_t timestamp, uint64_t duration);
+#endif
 
 #pragma mark - RZDBNotification interface
 
@@ -46,6 +60,8 @@ static NSString* const kRZDBCoalesceStorageKey = @"RZDBCoalesce";
 
 + (instancetype)notificationWithInvocation:(NSInvocation *)invocation;
 
+- (instancetype)initWithTarget:(id)target action:(SEL)action changeDict:(NSMutableDictionary *)changeDict;
+
 - (void)send;
 
 @end
@@ -65,14 +81,36 @@ static NSString* const kRZDBCoalesceStorageKey = @"RZDBCoalesce";
 @interface RZDBCoalesce ()
 
 @property (assign, nonatomic) NSInteger beginCount;
+
+// notifications in the order they were added, plus an index of the same notifications for deduplication
 @property (strong, nonatomic, readonly) NSMutableArray *notifications;
+@property (strong, nonatomic, readonly) NSMutableSet *notificationIndex;
 
 @end
 
 #pragma mark - RZDBCoalesce implementation
 
+// releases the coalesce of a thread that exits without committing
+static void rz_releaseCoalesce(void *coalesce)
+{
+    CFRelease(coalesce);
+}
+
+// the key is created in +[RZDBCoalesce initialize], so this may only be called after RZDBCoalesce has been messaged
+static inline RZDBCoalesce* rz_currentCoalesce(void)
+{
+    return (__bridge RZDBCoalesce *)pthread_getspecific(kRZDBCoalesceKey);
+}
+
 @implementation RZDBCoalesce
 
++ (void)initialize
+{
+    if ( self == [RZDBCoalesce class] ) {
+        pthread_key_create(&kRZDBCoalesceKey, rz_releaseCoalesce);
+    }
+}
+
 + (void)begin
 {
     RZDBCoalesce *current = [self currentCoalesce];
@@ -111,16 +149,17 @@ static NSString* const kRZDBCoalesceStorageKey = @"RZDBCoalesce";
 
 + (RZDBCoalesce *)currentCoalesce
 {
-    return [NSThread currentThread].threadDictionary[kRZDBCoalesceStorageKey];
+    return rz_currentCoalesce();
 }
 
 + (void)setCurrentCoalesce:(RZDBCoalesce *)current
 {
-    if ( current != nil ) {
-        [NSThread currentThread].threadDictionary[kRZDBCoalesceStorageKey] = current;
-    }
-    else {
-        [[NSThread currentThread].threadDictionary removeObjectForKey:kRZDBCoalesceStorageKey];
+    void *previous = pthread_getspecific(kRZDBCoalesceKey);
+
+    pthread_setspecific(kRZDBCoalesceKey, (current != nil) ? CFBridgingRetain(current) : NULL);
+
+    if ( previous != NULL ) {
+        CFRelease(previous);
     }
 }
 
@@ -130,6 +169,7 @@ static NSString* const kRZDBCoalesceStorageKey = @"RZDBCoalesce";
     if ( self ) {
         _beginCount = 1;
         _notifications = [NSMutableArray array];
+        _notificationIndex = [NSMutableSet set];
     }
 
     return self;
@@ -137,30 +177,86 @@ static NSString* const kRZDBCoalesceStorageKey = @"RZDBCoalesce";
 
 - (void)addNotification:(RZDBNotification *)notification
 {
-    NSUInteger existingIdx = [self.notifications indexOfObjectPassingTest:^BOOL(RZDBNotification *existing, NSUInteger idx, BOOL *stop) {
-        return [notification isEqual:existing];
-    }];
+    RZDBNotification *existing = [self.notificationIndex member:notification];
 
-    if ( existingIdx != NSNotFound ) {
-        RZDBNotification *existing = self.notifications[existingIdx];
+    if ( existing != nil ) {
+#if RZDB_INSTRUMENTATION
+        rz_recordCoalescedNotification();
+#endif
 
-        if ( notification.changeDict[kRZDBChangeKeyNew] != nil ) {
-            existing.changeDict[kRZDBChangeKeyNew] = notification.changeDict[kRZDBChangeKeyNew];
-        }
-        else {
-            [existing.changeDict removeObjectForKey:kRZDBChangeKeyNew];
+        // the latest new value wins, and successive to-many changes become a single net change
+        if ( existing.changeDict != nil && notification.changeDict != nil ) {
+            existing.changeDict = [rz_mergeChangeDicts(existing.changeDict, notification.changeDict) mutableCopy];
         }
     }
     else {
         [self.notifications addObject:notification];
+        [self.notificationIndex addObject:notification];
+    }
+}
+
+@end
+
+#pragma mark - RZDBCoalesce+RZDataBinding_Private implementation
+
+@implementation RZDBCoalesce (RZDataBinding_Private)
+
++ (BOOL)rz_coalesceTarget:(id)target action:(SEL)action change:(NSDictionary *)change
+{
+    RZDBCoalesce *currentCoalesce = rz_currentCoalesce();
+
+    if ( currentCoalesce != nil ) {
+        RZDBNotification *notification = [[RZDBNotification alloc] initWithTarget:target action:action changeDict:[change mutableCopy]];
+
+        [currentCoalesce addNotification:notification];
+    }
+
+    return (currentCoalesce != nil);
+}
+
++ (instancetype)rz_detachedCoalesce
+{
+    return [[self alloc] init];
+}
+
+- (void)rz_deferTarget:(id)target action:(SEL)action change:(NSDictionary *)change
+{
+    [self addNotification:[[RZDBNotification alloc] initWithTarget:target action:action changeDict:[change mutableCopy]]];
+}
+
+- (BOOL)rz_sendNotifications
+{
+    if ( self.notifications.count == 0 ) {
+        return NO;
     }
+
+    // sending may defer more callbacks, which are sent by the next call
+    NSArray *notifications = [self.notifications copy];
+
+    [self.notifications removeAllObjects];
+    [self.notificationIndex removeAllObjects];
+
+    [notifications enumerateObjectsUsingBlock:^(RZDBNotification *notification, NSUInteger idx, BOOL *stop) {
+        [notification send];
+    }];
+
+    return YES;
+}
+
+- (BOOL)rz_hasNotifications
+{
+    return (self.notifications.count > 0);
 }
 
 @end
 
 #pragma mark - RZDBNotification implementation
 
-@implementation RZDBNotification
+@implementation RZDBNotification {
+    // the target is weak, so hashing uses its address, which can't change while coalesced.
+    // A dead target's address may be reused, so equality also requires the target to still be alive.
+    __unsafe_unretained id _targetAddress;
+}
 
 + (instancetype)notificationWithInvocation:(NSInvocation *)invocation
 {
@@ -171,34 +267,59 @@ static NSString* const kRZDBCoalesceStorageKey = @"RZDBCoalesce";
     // rzdb callbacks must have void return type, and
     // if there are any arguments, the first and only argument must be a dictionary
     if ( methodSig.methodReturnLength == 0 && (methodSig.numberOfArguments == 2 || methodSig.numberOfArguments == 3) ) {
-        notification = [[self alloc] init];
-        notification.target = invocation.target;
-        notification.action = invocation.selector;
+        NSMutableDictionary *changeDict = nil;
 
         if ( methodSig.numberOfArguments == 3 && strcmp([methodSig getArgumentTypeAtIndex:2], @encode(id)) == 0 ) {
             __unsafe_unretained id arg1;
             [invocation getArgument:&arg1 atIndex:2];
 
             if ( [arg1 isKindOfClass:[NSDictionary class]] ) {
-                notification.changeDict = [arg1 mutableCopy];
+                changeDict = [arg1 mutableCopy];
             }
             else {
-                notification = nil;
+                return nil;
             }
         }
+
+        notification = [[self alloc] initWithTarget:invocation.target action:invocation.selector changeDict:changeDict];
     }
 
     return notification;
 }
 
+- (instancetype)initWithTarget:(id)target action:(SEL)action changeDict:(NSMutableDictionary *)changeDict
+{
+    self = [super init];
+    if ( self != nil ) {
+        _target = target;
+        _targetAddress = target;
+        _action = action;
+        _changeDict = changeDict;
+    }
+
+    return self;
+}
+
+- (NSUInteger)hash
+{
+    NSUInteger hash = (NSUInteger)(__bridge void *)_targetAddress ^ (NSUInteger)(void *)self.action;
+
+    // must agree with isEqual:, which compares the changed object by identity and the key path by value
+    hash ^= (NSUInteger)(__bridge void *)self.changeDict[kRZDBChangeKeyObject];
+    hash ^= [self.changeDict[kRZDBChangeKeyKeyPath] hash];
+
+    return hash;
+}
+
 - (BOOL)isEqual:(id)object
 {
     BOOL equal = [super isEqual:object];
 
     if ( !equal && [object isKindOfClass:[RZDBNotification class]] ) {
         RZDBNotification *other = (RZDBNotification *)object;
+        id target = self.target;
 
-        equal = (self.target == other.target) &&
+        equal = (target != nil && target == other.target) &&
         (self.action == other.action) &&
         (self.changeDict == other.changeDict ||
          (self.changeDict[kRZDBChangeKeyObject] == other.changeDict[kRZDBChangeKeyObject] &&
@@ -212,13 +333,23 @@ static NSString* const kRZDBCoalesceStorageKey = @"RZDBCoalesce";
 
 - (void)send
 {
-    if ( self.target != nil && self.action != NULL ) {
+    id target = self.target;
+
+    if ( target != nil && self.action != NULL ) {
+#if RZDB_INSTRUMENTATION
+        uint64_t start = rz_instrumentationTime();
+#endif
+
         if ( self.changeDict != nil ) {
-            ((void(*)(id, SEL, NSDictionary *))objc_msgSend)(self.target, self.action, [self.changeDict copy]);
+            ((void(*)(id, SEL, NSDictionary *))objc_msgSend)(target, self.action, [self.changeDict copy]);
         }
         else {
-            ((void(*)(id, SEL))objc_msgSend)(self.target, self.action);
+            ((void(*)(id, SEL))objc_msgSend)(target, self.action);
         }
+
+#if RZDB_INSTRUMENTATION
+        rz_recordCoalescedDelivery(target, self.action, start, rz_instrumentationTime() - start);
+#endif
     }
 }
 
@@ -230,16 +361,18 @@ static NSString* const kRZDBCoalesceStorageKey = @"RZDBCoalesce";
 
 - (id)rz_coalesceProxy
 {
-    @synchronized (self) {
-        id proxy = objc_getAssociatedObject(self, _cmd);
+    rz_lockObject(self);
 
-        if ( proxy == nil ) {
-            proxy = [RZDBCoalesceProxy proxyForObject:self];
-            objc_setAssociatedObject(self, _cmd, proxy, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
-        }
+    id proxy = objc_getAssociatedObject(self, _cmd);
 
-        return proxy;
+    if ( proxy == nil ) {
+        proxy = [RZDBCoalesceProxy proxyForObject:self];
+        objc_setAssociatedObject(self, _cmd, proxy, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
     }
+
+    rz_unlockObject(self);
+
+    return proxy;
 }
 
 @end
@@ -0,0 +1,67 @@
+//
+//  RZDBDerivedValue.h
+//
+//  A memoized value reduced from several key paths of an object.
+
+// Copyright 2014 Raizlabs and other contributors
+// http://raizlabs.com/
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+#import "RZDBTransforms.h"
+
+#pragma mark - RZDBDerivedValue interface
+
+/**
+ *  A value computed from several key paths of an object by a reducer, such as a full name from first and last names.
+ *
+ *  The value is computed lazily and memoized: a change to any of the key paths only marks it as stale, and it is
+ *  recomputed the next time it is read. If the value is observed (e.g. a key is bound to it), it is recomputed
+ *  when a key path changes, or once when the current RZDBCoalesce is committed if a coalesce is in progress.
+ *  Observers are only notified if the recomputed value is not equal to the previous one.
+ *
+ *  @example self.fullName = [RZDBDerivedValue derivedValueWithKeyPaths:@[RZDB_KP(Person, firstName), RZDB_KP(Person, lastName)] ofObject:person reducer:^id (NSArray *values) {
+ *               return [values componentsJoinedByString:@" "];
+ *           }];
+ *
+ *           [label rz_bindKey:RZDB_KP(UILabel, text) toKeyPath:RZDB_KP(RZDBDerivedValue, value) ofObject:self.fullName];
+ */
+@interface RZDBDerivedValue : NSObject
+
+/**
+ *  Returns a new derived value. The derived value does not retain the object, and callers must keep a strong reference to the derived value.
+ *
+ *  @param keyPaths The key paths of the object that the value depends on. Must be KVC compliant.
+ *  @param object   The object whose key paths the value depends on.
+ *  @param reducer  Computes the value from the values of the key paths, in the same order as keyPaths. Must be non-nil.
+ *
+ *  @see RZDBTransforms for constant reducers.
+ */
++ (instancetype)derivedValueWithKeyPaths:(NSArray *)keyPaths ofObject:(id)object reducer:(RZDBKeyBindingReducer)reducer;
+
+/**
+ *  The current value of the reducer. This property is KVO compliant.
+ */
+@property (strong, nonatomic, readonly) id value;
+
+@end
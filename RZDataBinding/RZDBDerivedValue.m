@@ -0,0 +1,176 @@
+//
+//  RZDBDerivedValue.m
+//
+//  A memoized value reduced from several key paths of an object.
+
+// Copyright 2014 Raizlabs and other contributors
+// http://raizlabs.com/
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#import <objc/runtime.h>
+
+#import "RZDBDerivedValue.h"
+
+#import "NSObject+RZDataBinding.h"
+#import "RZDBCoalesce.h"
+#import "RZDBKeyPath.h"
+#import "RZDBMacros.h"
+
+// implemented in NSObject+RZDataBinding.m
+OBJC_EXTERN void rz_lockObject(__unsafe_unretained id object);
+OBJC_EXTERN void rz_unlockObject(__unsafe_unretained id object);
+OBJC_EXTERN BOOL rz_deferPropagatingCallback(id target, SEL action, NSDictionary *change);
+
+// implemented in RZDBCoalesce.m
+@interface RZDBCoalesce (RZDataBinding_Private)
+
+// returns NO if no coalesce is in progress on the current thread, in which case the callback should be sent immediately
++ (BOOL)rz_coalesceTarget:(id)target action:(SEL)action change:(NSDictionary *)change;
+
+@end
+
+#pragma mark - RZDBDerivedValue implementation
+
+@implementation RZDBDerivedValue {
+    __weak id _object;
+    NSArray *_keyPaths;
+    RZDBKeyBindingReducer _reducer;
+
+    // guarded by the receiver's lock stripe. The memoized value is only current if the receiver isn't dirty.
+    id _value;
+    BOOL _dirty;
+}
+
++ (instancetype)derivedValueWithKeyPaths:(NSArray *)keyPaths ofObject:(id)object reducer:(RZDBKeyBindingReducer)reducer
+{
+    return [[self alloc] initWithKeyPaths:keyPaths ofObject:object reducer:reducer];
+}
+
+- (instancetype)initWithKeyPaths:(NSArray *)keyPaths ofObject:(id)object reducer:(RZDBKeyBindingReducer)reducer
+{
+    NSParameterAssert(reducer);
+
+    self = [super init];
+    if ( self != nil ) {
+        _object = object;
+        _keyPaths = [keyPaths copy];
+        _reducer = [reducer copy];
+        _dirty = YES;
+
+        // not coalesced, so that the value is marked dirty right away even during a coalesce
+        [object rz_addTarget:self action:@selector(keyPathsChanged) forKeyPathChanges:_keyPaths];
+    }
+
+    return self;
+}
+
+- (id)value
+{
+    rz_lockObject(self);
+
+    BOOL dirty = _dirty;
+    id value = _value;
+
+    rz_unlockObject(self);
+
+    if ( dirty ) {
+        value = [self reducedValue];
+
+        // an observed value is only memoized when its observers are notified, so that none of them miss the change
+        if ( self.observationInfo == NULL ) {
+            rz_lockObject(self);
+
+            _value = value;
+            _dirty = NO;
+
+            rz_unlockObject(self);
+        }
+    }
+
+    return value;
+}
+
+#pragma mark - private methods
+
+- (void)keyPathsChanged
+{
+    rz_lockObject(self);
+    _dirty = YES;
+    rz_unlockObject(self);
+
+    // an unobserved value is recomputed when it is next read. An observed value is committed once a propagating change
+    // or coalesce completes, so that it isn't computed from key paths that ordered bindings have yet to set.
+    if ( self.observationInfo != NULL &&
+         !rz_deferPropagatingCallback(self, @selector(commitValue), nil) &&
+         ![RZDBCoalesce rz_coalesceTarget:self action:@selector(commitValue) change:nil] ) {
+        [self commitValue];
+    }
+}
+
+- (void)commitValue
+{
+    rz_lockObject(self);
+
+    BOOL dirty = _dirty;
+    id oldValue = _value;
+
+    rz_unlockObject(self);
+
+    if ( !dirty ) {
+        return;
+    }
+
+    id value = [self reducedValue];
+
+    // once clean, -value returns the memoized old value, which is what KVO reads in -willChangeValueForKey:
+    rz_lockObject(self);
+    _dirty = NO;
+    rz_unlockObject(self);
+
+    if ( value == oldValue || [value isEqual:oldValue] ) {
+        return;
+    }
+
+    [self willChangeValueForKey:RZDB_KP_SELF(value)];
+
+    rz_lockObject(self);
+    _value = value;
+    rz_unlockObject(self);
+
+    [self didChangeValueForKey:RZDB_KP_SELF(value)];
+}
+
+- (id)reducedValue
+{
+    id object = _object;
+    NSMutableArray *values = [NSMutableArray arrayWithCapacity:_keyPaths.count];
+
+    for ( NSString *keyPath in _keyPaths ) {
+        id value = (object != nil) ? [[RZDBKeyPath keyPathWithString:keyPath forClass:object_getClass(object)] valueForObject:object] : nil;
+
+        [values addObject:value ?: [NSNull null]];
+    }
+
+    return _reducer(values);
+}
+
+@end
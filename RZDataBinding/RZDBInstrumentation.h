@@ -0,0 +1,114 @@
+//
+//  RZDBInstrumentation.h
+//
+//  Statistics and recordings of the notifications sent by RZDataBinding, when RZDB_INSTRUMENTATION is enabled.
+
+// Copyright 2014 Raizlabs and other contributors
+// http://raizlabs.com/
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+// defines RZDB_INSTRUMENTATION
+#import "NSObject+RZDataBinding.h"
+
+#if RZDB_INSTRUMENTATION
+
+#pragma mark - RZDBInstrumentation interface
+
+/**
+ *  The class of the observed object, ignoring any KVO subclass.
+ */
+OBJC_EXTERN NSString* const kRZDBStatisticsKeyObjectClass;
+
+/**
+ *  The observed key path.
+ */
+OBJC_EXTERN NSString* const kRZDBStatisticsKeyKeyPath;
+
+/**
+ *  The class of the callback target, or of the object with the bound key.
+ */
+OBJC_EXTERN NSString* const kRZDBStatisticsKeyTargetClass;
+
+/**
+ *  An NSNumber with the number of notifications, including those that were coalesced.
+ */
+OBJC_EXTERN NSString* const kRZDBStatisticsKeyNotificationCount;
+
+/**
+ *  An NSNumber with the total time spent in callbacks, in nanoseconds.
+ */
+OBJC_EXTERN NSString* const kRZDBStatisticsKeyCallbackNanoseconds;
+
+/**
+ *  An NSArray of NSNumbers, where the value at index i is the number of callbacks that took between 2^i and 2^(i+1) nanoseconds.
+ */
+OBJC_EXTERN NSString* const kRZDBStatisticsKeyLatencyHistogram;
+
+/**
+ *  Statistics collected when RZDB_INSTRUMENTATION is enabled. Collection is cheap enough to leave enabled in production,
+ *  so that statistics can be sampled periodically to find bindings and callbacks that are hot or slow.
+ */
+@interface RZDBInstrumentation : NSObject
+
+/**
+ *  Returns the statistics collected since the last reset, as an array of dictionaries containing values for the kRZDBStatisticsKeys.
+ *  There is one dictionary for each combination of observed class, key path, and target class that has been notified.
+ */
++ (NSArray *)snapshot;
+
+/**
+ *  The number of callbacks that were merged into an already pending callback by RZDBCoalesce, and so never sent.
+ */
++ (NSUInteger)coalescedNotificationCount;
+
+/**
+ *  Resets all statistics to zero.
+ */
++ (void)reset;
+
+/**
+ *  Starts recording every KVO change fanned out, callback sent, binding set and callback coalesced to a memory-mapped ring buffer,
+ *  replacing any recording in progress. Each event is a fixed-size record with a timestamp, thread, duration and the IDs of the
+ *  classes, key path and action involved. Once the ring is full, the oldest records are overwritten.
+ *
+ *  Appending a record takes a few atomic operations on the recording and a few unlocked stores, and nothing is done
+ *  while no recording is in progress, so recording can be left on in the field.
+ *  Recordings can be summarized with Tools/rzdb-decode, and their format is described in RZDBRecordFormat.h.
+ *
+ *  @param path     The file to record to. It is created, or truncated if it exists.
+ *  @param capacity The number of records to keep, rounded up to a power of two. Each record is 48 bytes.
+ *
+ *  @return NO if the file couldn't be created or mapped.
+ */
++ (BOOL)startRecordingToFile:(NSString *)path capacity:(NSUInteger)capacity;
+
+/**
+ *  Stops recording, waits for records still being appended on other threads, and then writes the recording to disk
+ *  and unmaps it.
+ */
++ (void)stopRecording;
+
+@end
+
+#endif
@@ -0,0 +1,533 @@
+//
+//  RZDBInstrumentation.m
+//
+//  Statistics and recordings of the notifications sent by RZDataBinding, when RZDB_INSTRUMENTATION is enabled.
+
+// Copyright 2014 Raizlabs and other contributors
+// http://raizlabs.com/
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#import <objc/runtime.h>
+#import <fcntl.h>
+#import <pthread.h>
+#import <sched.h>
+#import <stdatomic.h>
+#import <sys/mman.h>
+#import <time.h>
+#import <unistd.h>
+
+#if defined(__APPLE__)
+#import <mach/mach_time.h>
+#endif
+
+#import "RZDBInstrumentation.h"
+
+#import "RZDBMacros.h"
+#import "RZDBRecordFormat.h"
+
+#if RZDB_INSTRUMENTATION
+
+#pragma mark - RZDBStatistics interface
+
+#define RZDB_LATENCY_HISTOGRAM_BUCKETS 32
+
+// Counters for an (observed class, key path, target class) triple. Counters are updated atomically,
+// without locking, and records are never removed once created so observers can keep pointers to them.
+@interface RZDBStatistics : NSObject {
+    @public
+    atomic_uint_fast64_t _notificationCount;
+    atomic_uint_fast64_t _callbackNanoseconds;
+    atomic_uint_fast64_t _latencyHistogram[RZDB_LATENCY_HISTOGRAM_BUCKETS];
+}
+
++ (instancetype)statisticsForObjectClass:(Class)objectClass keyPath:(NSString *)keyPath targetClass:(Class)targetClass;
+
+@end
+
+#pragma mark - RZDBStatistics implementation
+
+NSString* const kRZDBStatisticsKeyObjectClass         = @"RZDBStatisticsObjectClass";
+NSString* const kRZDBStatisticsKeyKeyPath             = @"RZDBStatisticsKeyPath";
+NSString* const kRZDBStatisticsKeyTargetClass         = @"RZDBStatisticsTargetClass";
+NSString* const kRZDBStatisticsKeyNotificationCount   = @"RZDBStatisticsNotificationCount";
+NSString* const kRZDBStatisticsKeyCallbackNanoseconds = @"RZDBStatisticsCallbackNanoseconds";
+NSString* const kRZDBStatisticsKeyLatencyHistogram    = @"RZDBStatisticsLatencyHistogram";
+
+static atomic_uint_fast64_t kRZDBCoalescedNotificationCount = 0;
+
+// @[objectClass, keyPath, targetClass] -> statistics
+static NSMutableDictionary *s_statistics = nil;
+static pthread_mutex_t s_statisticsLock = PTHREAD_MUTEX_INITIALIZER;
+
+@implementation RZDBStatistics {
+    Class _objectClass;
+    NSString *_keyPath;
+    Class _targetClass;
+}
+
++ (instancetype)statisticsForObjectClass:(Class)objectClass keyPath:(NSString *)keyPath targetClass:(Class)targetClass
+{
+    NSArray *key = @[objectClass, keyPath, targetClass];
+
+    pthread_mutex_lock(&s_statisticsLock);
+
+    if ( s_statistics == nil ) {
+        s_statistics = [NSMutableDictionary dictionary];
+    }
+
+    RZDBStatistics *statistics = s_statistics[key];
+
+    if ( statistics == nil ) {
+        statistics = [[self alloc] init];
+        statistics->_objectClass = objectClass;
+        statistics->_keyPath = [keyPath copy];
+        statistics->_targetClass = targetClass;
+
+        s_statistics[key] = statistics;
+    }
+
+    pthread_mutex_unlock(&s_statisticsLock);
+
+    return statistics;
+}
+
+- (NSDictionary *)dictionaryRepresentation
+{
+    NSMutableArray *histogram = [NSMutableArray arrayWithCapacity:RZDB_LATENCY_HISTOGRAM_BUCKETS];
+
+    for ( NSUInteger i = 0; i < RZDB_LATENCY_HISTOGRAM_BUCKETS; i++ ) {
+        [histogram addObject:@(atomic_load_explicit(&_latencyHistogram[i], memory_order_relaxed))];
+    }
+
+    return @{ kRZDBStatisticsKeyObjectClass : _objectClass,
+              kRZDBStatisticsKeyKeyPath : _keyPath,
+              kRZDBStatisticsKeyTargetClass : _targetClass,
+              kRZDBStatisticsKeyNotificationCount : @(atomic_load_explicit(&_notificationCount, memory_order_relaxed)),
+              kRZDBStatisticsKeyCallbackNanoseconds : @(atomic_load_explicit(&_callbackNanoseconds, memory_order_relaxed)),
+              kRZDBStatisticsKeyLatencyHistogram : histogram };
+}
+
+- (void)reset
+{
+    atomic_store_explicit(&_notificationCount, 0, memory_order_relaxed);
+    atomic_store_explicit(&_callbackNanoseconds, 0, memory_order_relaxed);
+
+    for ( NSUInteger i = 0; i < RZDB_LATENCY_HISTOGRAM_BUCKETS; i++ ) {
+        atomic_store_explicit(&_latencyHistogram[i], 0, memory_order_relaxed);
+    }
+}
+
+@end
+
+#pragma mark - Counters
+
+RZDBStatistics* rz_statistics(Class objectClass, NSString *keyPath, Class targetClass)
+{
+    return [RZDBStatistics statisticsForObjectClass:objectClass keyPath:keyPath targetClass:targetClass];
+}
+
+void rz_recordNotification(RZDBStatistics *statistics)
+{
+    atomic_fetch_add_explicit(&statistics->_notificationCount, 1, memory_order_relaxed);
+}
+
+uint64_t rz_instrumentationTime(void)
+{
+#if defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info(&timebase);
+    });
+
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t)time.tv_sec * NSEC_PER_SEC + (uint64_t)time.tv_nsec;
+#endif
+}
+
+void rz_recordCallbackLatency(RZDBStatistics *statistics, uint64_t nanoseconds)
+{
+    // bucket i holds durations in [2^i, 2^(i+1)) nanoseconds
+    NSUInteger bucket = (nanoseconds > 0) ? (NSUInteger)(63 - __builtin_clzll(nanoseconds)) : 0;
+    bucket = MIN(bucket, RZDB_LATENCY_HISTOGRAM_BUCKETS - 1);
+
+    atomic_fetch_add_explicit(&statistics->_callbackNanoseconds, nanoseconds, memory_order_relaxed);
+    atomic_fetch_add_explicit(&statistics->_latencyHistogram[bucket], 1, memory_order_relaxed);
+}
+
+void rz_recordCoalescedNotification(void)
+{
+    atomic_fetch_add_explicit(&kRZDBCoalescedNotificationCount, 1, memory_order_relaxed);
+}
+
+#pragma mark - Recording
+
+// the size of the string table of each recording. Strings that don't fit are left out, and tools show their IDs instead.
+static const uint64_t kRZDBRecordStringCapacity = 1 << 20;
+
+// a mapped recording. Each recorder counts the threads appending to it, so that stopping can wait for them before unmapping.
+// A thread may load a recorder just as it stops, so recorders are never freed, and only their mappings are torn down.
+typedef struct {
+    RZDBRecordFileHeader *header;
+    char *strings;
+    RZDBRecord *records;
+    uint64_t mask;
+    size_t length;
+    int fd;
+
+    // an appender increments appenders before checking stopped, and stopping sets stopped before checking appenders,
+    // both with sequentially consistent ordering, so at least one of them sees the other
+    atomic_long appenders;
+    atomic_bool stopped;
+} RZDBRecorder;
+
+static _Atomic(RZDBRecorder *) s_recorder = NULL;
+
+// (class or selector) address -> string ID, copied string -> string ID, and the names of the IDs in order, so that a recording
+// started later can write the names of everything registered before it. Strings are keyed by value, since an interned string
+// may be freed and another allocated at its address. Guarded by s_recordingLock, as are string table writes.
+static NSMapTable *s_recordingIDs = nil;
+static NSMutableDictionary *s_recordingStringIDs = nil;
+static NSMutableArray *s_recordingNames = nil;
+static pthread_mutex_t s_recordingLock = PTHREAD_MUTEX_INITIALIZER;
+
+// holds a small number for each thread that has appended a record
+static pthread_key_t kRZDBRecordingThreadKey;
+static atomic_uint_fast32_t kRZDBRecordingThreadCount = 0;
+
+static void rz_recorderAddString(RZDBRecorder *recorder, uint32_t identifier, const char *name)
+{
+    RZDBRecordString entry = { identifier, (uint32_t)strlen(name) };
+    uint64_t offset = recorder->header->stringLength;
+    uint64_t size = (sizeof(entry) + entry.length + 1 + 3) & ~3ULL;
+
+    if ( offset + size <= recorder->header->stringCapacity ) {
+        memcpy(recorder->strings + offset, &entry, sizeof(entry));
+        memcpy(recorder->strings + offset + sizeof(entry), name, entry.length + 1);
+
+        atomic_store_explicit((_Atomic(uint64_t) *)&recorder->header->stringLength, offset + size, memory_order_release);
+    }
+}
+
+// must be called with s_recordingLock held
+static NSNumber* rz_addRecordingName(const char *name)
+{
+    [s_recordingNames addObject:@(name ?: "")];
+    NSNumber *identifier = @(s_recordingNames.count);
+
+    RZDBRecorder *recorder = atomic_load_explicit(&s_recorder, memory_order_relaxed);
+
+    if ( recorder != NULL ) {
+        rz_recorderAddString(recorder, identifier.unsignedIntValue, name ?: "");
+    }
+
+    return identifier;
+}
+
+// must be called with s_recordingLock held
+static void rz_createRecordingIDs(void)
+{
+    if ( s_recordingIDs == nil ) {
+        s_recordingIDs = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality valueOptions:NSPointerFunctionsStrongMemory];
+        s_recordingStringIDs = [NSMutableDictionary dictionary];
+        s_recordingNames = [NSMutableArray array];
+    }
+}
+
+static uint32_t rz_recordingID(const void *key, const char *name)
+{
+    if ( key == NULL ) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&s_recordingLock);
+
+    rz_createRecordingIDs();
+
+    NSNumber *identifier = [s_recordingIDs objectForKey:(__bridge id)key];
+
+    if ( identifier == nil ) {
+        identifier = rz_addRecordingName(name);
+        [s_recordingIDs setObject:identifier forKey:(__bridge id)key];
+    }
+
+    pthread_mutex_unlock(&s_recordingLock);
+
+    return identifier.unsignedIntValue;
+}
+
+static uint32_t rz_recordingStringID(NSString *string)
+{
+    if ( string == nil ) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&s_recordingLock);
+
+    rz_createRecordingIDs();
+
+    NSNumber *identifier = s_recordingStringIDs[string];
+
+    if ( identifier == nil ) {
+        // the dictionary copies the string, so the ID outlives the key path it was recorded for
+        identifier = rz_addRecordingName(string.UTF8String);
+        s_recordingStringIDs[string] = identifier;
+    }
+
+    pthread_mutex_unlock(&s_recordingLock);
+
+    return identifier.unsignedIntValue;
+}
+
+RZDBRecordSite rz_recordSite(Class objectClass, NSString *keyPath, Class targetClass, SEL action, NSString *boundKey)
+{
+    RZDBRecordSite site;
+
+    site.objectClass = rz_recordingID((__bridge const void *)objectClass, class_getName(objectClass));
+    site.keyPath = rz_recordingStringID(keyPath);
+    site.targetClass = rz_recordingID((__bridge const void *)targetClass, class_getName(targetClass));
+
+    if ( boundKey != nil ) {
+        site.action = rz_recordingStringID(boundKey);
+    }
+    else {
+        site.action = rz_recordingID((const void *)action, (action != NULL) ? sel_getName(action) : NULL);
+    }
+
+    return site;
+}
+
+BOOL rz_isRecording(void)
+{
+    return (atomic_load_explicit(&s_recorder, memory_order_relaxed) != NULL);
+}
+
+void rz_appendRecord(RZDBRecordSite site, uint16_t flags, uint64_t timestamp, uint64_t duration, NSUInteger fanout)
+{
+    RZDBRecorder *recorder = atomic_load_explicit(&s_recorder, memory_order_acquire);
+
+    if ( recorder == NULL ) {
+        return;
+    }
+
+    atomic_fetch_add(&recorder->appenders, 1);
+
+    if ( atomic_load(&recorder->stopped) ) {
+        atomic_fetch_sub_explicit(&recorder->appenders, 1, memory_order_release);
+        return;
+    }
+
+    uintptr_t thread = (uintptr_t)pthread_getspecific(kRZDBRecordingThreadKey);
+
+    if ( thread == 0 ) {
+        thread = atomic_fetch_add_explicit(&kRZDBRecordingThreadCount, 1, memory_order_relaxed) + 1;
+        pthread_setspecific(kRZDBRecordingThreadKey, (void *)thread);
+    }
+
+    // appending claims a slot with a single atomic increment, and then writes it without locking
+    uint64_t index = atomic_fetch_add_explicit((_Atomic(uint64_t) *)&recorder->header->recordCount, 1, memory_order_relaxed);
+    RZDBRecord *record = &recorder->records[index & recorder->mask];
+    _Atomic(uint64_t) *sequence = (_Atomic(uint64_t) *)&record->sequence;
+
+    // the slot may hold an older record, so it is marked incomplete before any of its fields change
+    atomic_store_explicit(sequence, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    record->timestamp = timestamp;
+    record->duration = (uint32_t)MIN(duration, (uint64_t)UINT32_MAX);
+    record->thread = (uint32_t)thread;
+    record->objectClass = site.objectClass;
+    record->keyPath = site.keyPath;
+    record->targetClass = site.targetClass;
+    record->action = site.action;
+    record->fanout = (uint32_t)MIN(fanout, (NSUInteger)UINT32_MAX);
+    record->flags = flags;
+    record->reserved = 0;
+
+    atomic_store_explicit(sequence, index + 1, memory_order_release);
+
+    atomic_fetch_sub_explicit(&recorder->appenders, 1, memory_order_release);
+}
+
+// waits for threads still appending to the recorder, and then writes the recording to disk and unmaps it
+static void rz_recorderStop(RZDBRecorder *recorder)
+{
+    atomic_store(&recorder->stopped, true);
+
+    // appending is a handful of stores, so callbacks on other threads finish with the recording almost immediately
+    while ( atomic_load(&recorder->appenders) > 0 ) {
+        sched_yield();
+    }
+
+    msync(recorder->header, recorder->length, MS_SYNC);
+    munmap(recorder->header, recorder->length);
+    close(recorder->fd);
+
+    recorder->header = NULL;
+    recorder->strings = NULL;
+    recorder->records = NULL;
+}
+
+void rz_recordCoalescedDelivery(id target, SEL action, uint64_t timestamp, uint64_t duration)
+{
+    if ( rz_isRecording() ) {
+        RZDBRecordSite site = { 0 };
+        Class targetClass = [target class];
+
+        site.targetClass = rz_recordingID((__bridge const void *)targetClass, class_getName(targetClass));
+        site.action = rz_recordingID((const void *)action, sel_getName(action));
+
+        rz_appendRecord(site, RZDB_RECORD_FLAG_DELIVERED | RZDB_RECORD_FLAG_COALESCED, timestamp, duration, 0);
+    }
+}
+
+#pragma mark - RZDBInstrumentation implementation
+
+@implementation RZDBInstrumentation
+
++ (NSArray *)snapshot
+{
+    NSMutableArray *snapshot = [NSMutableArray array];
+
+    pthread_mutex_lock(&s_statisticsLock);
+
+    for ( RZDBStatistics *statistics in [s_statistics objectEnumerator] ) {
+        if ( atomic_load_explicit(&statistics->_notificationCount, memory_order_relaxed) > 0 ) {
+            [snapshot addObject:[statistics dictionaryRepresentation]];
+        }
+    }
+
+    pthread_mutex_unlock(&s_statisticsLock);
+
+    return snapshot;
+}
+
++ (NSUInteger)coalescedNotificationCount
+{
+    return (NSUInteger)atomic_load_explicit(&kRZDBCoalescedNotificationCount, memory_order_relaxed);
+}
+
++ (void)reset
+{
+    pthread_mutex_lock(&s_statisticsLock);
+
+    for ( RZDBStatistics *statistics in [s_statistics objectEnumerator] ) {
+        [statistics reset];
+    }
+
+    pthread_mutex_unlock(&s_statisticsLock);
+
+    atomic_store_explicit(&kRZDBCoalescedNotificationCount, 0, memory_order_relaxed);
+}
+
++ (BOOL)startRecordingToFile:(NSString *)path capacity:(NSUInteger)capacity
+{
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&kRZDBRecordingThreadKey, NULL);
+    });
+
+    [self stopRecording];
+
+    uint64_t recordCapacity = 1;
+
+    while ( recordCapacity < capacity ) {
+        recordCapacity <<= 1;
+    }
+
+    uint64_t stringOffset = sizeof(RZDBRecordFileHeader);
+    uint64_t recordOffset = stringOffset + kRZDBRecordStringCapacity;
+    size_t length = (size_t)(recordOffset + recordCapacity * sizeof(RZDBRecord));
+
+    int fd = open(path.fileSystemRepresentation, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if ( fd < 0 ) {
+        RZDBLog(@"RZDataBinding couldn't create a recording at path:%@ (%s).", path, strerror(errno));
+        return NO;
+    }
+
+    // the file is sparse, so pages that are never written don't take up space
+    void *map = (ftruncate(fd, (off_t)length) == 0) ? mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+
+    if ( map == MAP_FAILED ) {
+        RZDBLog(@"RZDataBinding couldn't map a recording of %llu bytes at path:%@ (%s).", (unsigned long long)length, path, strerror(errno));
+        close(fd);
+        return NO;
+    }
+
+    RZDBRecordFileHeader *header = map;
+
+    memcpy(header->magic, RZDB_RECORD_MAGIC, sizeof(RZDB_RECORD_MAGIC));
+    header->version = RZDB_RECORD_VERSION;
+    header->recordSize = sizeof(RZDBRecord);
+    header->recordOffset = recordOffset;
+    header->recordCapacity = recordCapacity;
+    header->stringOffset = stringOffset;
+    header->stringCapacity = kRZDBRecordStringCapacity;
+
+    RZDBRecorder *recorder = calloc(1, sizeof(RZDBRecorder));
+
+    recorder->header = header;
+    recorder->strings = (char *)map + stringOffset;
+    recorder->records = (RZDBRecord *)((char *)map + recordOffset);
+    recorder->mask = recordCapacity - 1;
+    recorder->length = length;
+    recorder->fd = fd;
+
+    pthread_mutex_lock(&s_recordingLock);
+
+    [s_recordingNames enumerateObjectsUsingBlock:^(NSString *name, NSUInteger idx, BOOL *stop) {
+        rz_recorderAddString(recorder, (uint32_t)idx + 1, name.UTF8String);
+    }];
+
+    // another recording may have been started concurrently since the one in progress was stopped above
+    RZDBRecorder *replacedRecorder = atomic_exchange_explicit(&s_recorder, recorder, memory_order_acq_rel);
+
+    pthread_mutex_unlock(&s_recordingLock);
+
+    if ( replacedRecorder != NULL ) {
+        rz_recorderStop(replacedRecorder);
+    }
+
+    return YES;
+}
+
++ (void)stopRecording
+{
+    pthread_mutex_lock(&s_recordingLock);
+
+    RZDBRecorder *recorder = atomic_exchange(&s_recorder, NULL);
+
+    pthread_mutex_unlock(&s_recordingLock);
+
+    if ( recorder != NULL ) {
+        rz_recorderStop(recorder);
+    }
+}
+
+@end
+
+#endif
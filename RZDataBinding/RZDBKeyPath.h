@@ -0,0 +1,75 @@
+//
+//  RZDBKeyPath.h
+//
+//  Key paths compiled for a class, which read object-typed properties by calling their getters directly.
+
+// Copyright 2014 Raizlabs and other contributors
+// http://raizlabs.com/
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+#pragma mark - RZDBKeyPath interface
+
+/**
+ *  A key path that has been parsed and resolved for objects of a particular class.
+ *
+ *  RZDataBinding compiles the key paths it reads values for, and caches the results per class and key path.
+ *  Each key in the key path that corresponds to an object-typed property is read by calling the property's getter
+ *  implementation directly, and other keys fall back to KVC.
+ *
+ *  An RZDBKeyPath is an NSString, so it can be passed to any method that takes a key path.
+ *  Passing a key path compiled for the correct class to the RZDataBinding methods avoids the cache lookup entirely.
+ *  A compiled key path that is kept around is recompiled on its next use after rz_invalidateCallbackCache() is called.
+ *
+ *  @example static RZDBKeyPath *titleKeyPath = [RZDBKeyPath keyPathWithString:RZDB_KP(MyModel, author.name) forClass:[MyModel class]];
+ */
+@interface RZDBKeyPath : NSString
+
+/**
+ *  Returns a compiled key path for objects of the given class. Subsequent calls with the same arguments return the same object.
+ *
+ *  @param keyPath     The key path to compile. Must be non-nil.
+ *  @param objectClass The class of the objects the key path will be evaluated on. Must be non-nil.
+ *
+ *  @return A compiled key path, equal to the keyPath string.
+ */
++ (instancetype)keyPathWithString:(NSString *)keyPath forClass:(Class)objectClass;
+
+/**
+ *  The class of the objects the key path was compiled for.
+ */
+@property (assign, nonatomic, readonly) Class objectClass;
+
+/**
+ *  The keys in the key path.
+ */
+@property (copy, nonatomic, readonly) NSArray *components;
+
+/**
+ *  Returns the value for the key path of the given object. Equivalent to [object valueForKeyPath:keyPath].
+ *
+ *  @param object The object to evaluate the key path on. Need not be an instance of objectClass, but evaluation is fastest if it is.
+ */
+- (id)valueForObject:(id)object;
+
+@end
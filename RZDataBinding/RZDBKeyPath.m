@@ -0,0 +1,284 @@
+//
+//  RZDBKeyPath.m
+//
+//  Key paths compiled for a class, which read object-typed properties by calling their getters directly.
+
+// Copyright 2014 Raizlabs and other contributors
+// http://raizlabs.com/
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#import <objc/runtime.h>
+#import <pthread.h>
+#import <stdatomic.h>
+
+#import "RZDBKeyPath.h"
+
+// implemented in NSObject+RZDataBinding.m
+OBJC_EXTERN atomic_uint_fast32_t kRZDBCallbackGeneration;
+
+#pragma mark - RZDBKeyPath implementation
+
+// a single key of a compiled key path. The getter is NULL if the key must be read using KVC.
+typedef struct {
+    __unsafe_unretained NSString *key;
+    __unsafe_unretained Class objectClass;
+
+    SEL getter;
+    IMP getterIMP;
+} RZDBKeyPathComponent;
+
+// compiled key paths by class, then by string. Emptied by rz_invalidateKeyPathCache().
+// Also guards recompiling a key path, so that concurrent readers of a stale key path compile it once.
+static NSMapTable *s_keyPathsByClass = nil;
+static pthread_mutex_t s_keyPathsLock = PTHREAD_MUTEX_INITIALIZER;
+
+@implementation RZDBKeyPath {
+    NSString *_string;
+    NSUInteger _componentCount;
+
+    // the current compiled components. Recompiling publishes a new array rather than changing this one,
+    // since other threads may be reading it, so every array is kept in _compilations until the key path is deallocated.
+    _Atomic(RZDBKeyPathComponent *) _compiledComponents;
+    NSMutableArray *_compilations;
+
+    // the key path is recompiled once this no longer matches kRZDBCallbackGeneration
+    atomic_uint_fast32_t _generation;
+}
+
++ (instancetype)keyPathWithString:(NSString *)keyPath forClass:(Class)objectClass
+{
+    NSParameterAssert(keyPath);
+    NSParameterAssert(objectClass);
+
+    if ( [keyPath isKindOfClass:[RZDBKeyPath class]] && ((RZDBKeyPath *)keyPath).objectClass == objectClass ) {
+        return (RZDBKeyPath *)keyPath;
+    }
+
+    pthread_mutex_lock(&s_keyPathsLock);
+
+    if ( s_keyPathsByClass == nil ) {
+        s_keyPathsByClass = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality
+                                                  valueOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPersonality];
+    }
+
+    NSMutableDictionary *keyPaths = [s_keyPathsByClass objectForKey:objectClass];
+
+    if ( keyPaths == nil ) {
+        keyPaths = [NSMutableDictionary dictionary];
+        [s_keyPathsByClass setObject:keyPaths forKey:objectClass];
+    }
+
+    RZDBKeyPath *compiledKeyPath = keyPaths[keyPath];
+
+    if ( compiledKeyPath == nil ) {
+        compiledKeyPath = [[self alloc] initWithString:keyPath objectClass:objectClass];
+        keyPaths[compiledKeyPath] = compiledKeyPath;
+    }
+    else if ( ![compiledKeyPath isCurrent] ) {
+        // the class may have been disposed of, and another class allocated at its address
+        [compiledKeyPath recompile];
+    }
+
+    pthread_mutex_unlock(&s_keyPathsLock);
+
+    return compiledKeyPath;
+}
+
+- (instancetype)initWithString:(NSString *)keyPath objectClass:(Class)objectClass
+{
+    self = [super init];
+    if ( self != nil ) {
+        _string = [keyPath copy];
+        _objectClass = objectClass;
+        _components = [_string componentsSeparatedByString:@"."];
+        _compilations = [NSMutableArray array];
+
+        // collection operators (e.g. @sum) apply to the rest of the key path, so those key paths are always evaluated by KVC
+        _componentCount = ([_string rangeOfString:@"@"].location == NSNotFound) ? _components.count : 0;
+
+        [self recompile];
+    }
+
+    return self;
+}
+
+- (id)valueForObject:(id)object
+{
+    if ( _componentCount == 0 ) {
+        return [object valueForKeyPath:_string];
+    }
+
+    // a getter may have been swizzled since the key path was compiled, in which case every IMP is resolved again once
+    if ( atomic_load_explicit(&_generation, memory_order_acquire) != atomic_load_explicit(&kRZDBCallbackGeneration, memory_order_acquire) ) {
+        pthread_mutex_lock(&s_keyPathsLock);
+
+        if ( ![self isCurrent] ) {
+            [self recompile];
+        }
+
+        pthread_mutex_unlock(&s_keyPathsLock);
+    }
+
+    RZDBKeyPathComponent *components = atomic_load_explicit(&_compiledComponents, memory_order_acquire);
+
+    for ( NSUInteger i = 0; i < _componentCount && object != nil; i++ ) {
+        RZDBKeyPathComponent *component = &components[i];
+
+        if ( component->getter == NULL ) {
+            object = [object valueForKey:component->key];
+        }
+        else {
+            Class currentClass = object_getClass(object);
+            IMP getterIMP = component->getterIMP;
+
+            // the object may be a subclass (or e.g. a KVO subclass) that overrides the getter, or not implement it at all
+            if ( currentClass != component->objectClass ) {
+                getterIMP = class_respondsToSelector(currentClass, component->getter) ? class_getMethodImplementation(currentClass, component->getter) : NULL;
+            }
+
+            if ( getterIMP != NULL ) {
+                object = ((id (*)(id, SEL))getterIMP)(object, component->getter);
+            }
+            else {
+                object = [object valueForKey:component->key];
+            }
+        }
+    }
+
+    return object;
+}
+
+#pragma mark - NSString primitives
+
+- (NSUInteger)length
+{
+    return _string.length;
+}
+
+- (unichar)characterAtIndex:(NSUInteger)index
+{
+    return [_string characterAtIndex:index];
+}
+
+- (void)getCharacters:(unichar *)buffer range:(NSRange)range
+{
+    [_string getCharacters:buffer range:range];
+}
+
+- (NSUInteger)hash
+{
+    return _string.hash;
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    return self;
+}
+
+#pragma mark - private methods
+
+// NO if rz_invalidateCallbackCache() has been called since the key path was compiled, or if a class it was compiled for
+// no longer has the getter it resolved, e.g. because the class was disposed of and another allocated at its address
+- (BOOL)isCurrent
+{
+    if ( atomic_load_explicit(&_generation, memory_order_acquire) != atomic_load_explicit(&kRZDBCallbackGeneration, memory_order_acquire) ) {
+        return NO;
+    }
+
+    RZDBKeyPathComponent *components = atomic_load_explicit(&_compiledComponents, memory_order_acquire);
+
+    for ( NSUInteger i = 0; i < _componentCount; i++ ) {
+        RZDBKeyPathComponent *component = &components[i];
+
+        if ( component->getter != NULL && class_getMethodImplementation(component->objectClass, component->getter) != component->getterIMP ) {
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+// compiles the components into a new array, and publishes it. Must be called with s_keyPathsLock held, or from init.
+- (void)recompile
+{
+    uint_fast32_t generation = atomic_load_explicit(&kRZDBCallbackGeneration, memory_order_acquire);
+
+    NSMutableData *compilation = [NSMutableData dataWithLength:MAX(_componentCount, (NSUInteger)1) * sizeof(RZDBKeyPathComponent)];
+    RZDBKeyPathComponent *components = compilation.mutableBytes;
+
+    Class currentClass = _objectClass;
+
+    for ( NSUInteger i = 0; i < _componentCount; i++ ) {
+        components[i].key = _components[i];
+        currentClass = [self compileComponent:&components[i] forClass:currentClass];
+    }
+
+    [_compilations addObject:compilation];
+
+    atomic_store_explicit(&_compiledComponents, components, memory_order_release);
+    atomic_store_explicit(&_generation, generation, memory_order_release);
+}
+
+// returns the declared class of the component's value, if known
+- (Class)compileComponent:(RZDBKeyPathComponent *)component forClass:(Class)objectClass
+{
+    Class valueClass = Nil;
+
+    objc_property_t property = (objectClass != Nil) ? class_getProperty(objectClass, component->key.UTF8String) : NULL;
+    char *type = (property != NULL) ? property_copyAttributeValue(property, "T") : NULL;
+
+    // only object-typed properties are read directly, since other types would need to be boxed just like KVC does
+    if ( type != NULL && type[0] == _C_ID ) {
+        char *getterName = property_copyAttributeValue(property, "G");
+        SEL getter = (getterName != NULL) ? sel_registerName(getterName) : NSSelectorFromString(component->key);
+
+        free(getterName);
+
+        if ( class_respondsToSelector(objectClass, getter) ) {
+            component->objectClass = objectClass;
+            component->getter = getter;
+            component->getterIMP = class_getMethodImplementation(objectClass, getter);
+        }
+
+        // type encodings of objects with a known class look like @"ClassName"
+        size_t length = strlen(type);
+
+        if ( length > 3 && type[1] == '"' && type[length - 1] == '"' ) {
+            NSString *className = [[NSString alloc] initWithBytes:type + 2 length:length - 3 encoding:NSUTF8StringEncoding];
+            valueClass = NSClassFromString(className);
+        }
+    }
+
+    free(type);
+
+    return valueClass;
+}
+
+@end
+
+void rz_invalidateKeyPathCache(void)
+{
+    // key paths compiled from now on resolve the current getters, and those still in use are recompiled on their next use
+    pthread_mutex_lock(&s_keyPathsLock);
+    [s_keyPathsByClass removeAllObjects];
+    pthread_mutex_unlock(&s_keyPathsLock);
+}
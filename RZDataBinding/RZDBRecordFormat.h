@@ -0,0 +1,130 @@
+//
+//  RZDBRecordFormat.h
+//
+//  The on-disk format of recordings made by +[RZDBInstrumentation startRecordingToFile:capacity:].
+//  This is a plain C header, so that tools can decode recordings without Foundation.
+
+// Copyright 2014 Raizlabs and other contributors
+// http://raizlabs.com/
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef RZDBRecordFormat_h
+#define RZDBRecordFormat_h
+
+#include <stdint.h>
+
+#define RZDB_RECORD_MAGIC   "RZDBREC"
+#define RZDB_RECORD_VERSION 2
+
+/**
+ *  The record is of a KVO change fanned out to the observers of a key path. Its fanout is the number of observers.
+ */
+#define RZDB_RECORD_FLAG_CHANGE    (1 << 0)
+
+/**
+ *  A callback was sent, or a key was set by a binding. Its duration is the time spent doing so.
+ */
+#define RZDB_RECORD_FLAG_DELIVERED (1 << 1)
+
+/**
+ *  The callback was handed to an RZDBCoalesce instead of being sent. If RZDB_RECORD_FLAG_DELIVERED is also set,
+ *  the record is of the coalesced callback being sent when the coalesce committed.
+ */
+#define RZDB_RECORD_FLAG_COALESCED (1 << 2)
+
+/**
+ *  The file begins with this header, followed by the string table at stringOffset and the records at recordOffset.
+ *  All values are in the byte order of the recording device.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+
+    // the records form a ring of recordCapacity slots, which is a power of two
+    uint64_t recordOffset;
+    uint64_t recordCapacity;
+
+    uint64_t stringOffset;
+    uint64_t stringCapacity;
+
+    // the number of records ever appended. Record n is in slot n % recordCapacity, so once the ring has wrapped,
+    // the oldest record is record recordCount - recordCapacity.
+    uint64_t recordCount;
+
+    // the number of bytes of the string table in use
+    uint64_t stringLength;
+} RZDBRecordFileHeader;
+
+/**
+ *  The string table is a sequence of these entries, each followed by length bytes of UTF-8 and a NUL,
+ *  and padded to a multiple of 4 bytes. A string ID of 0 means none.
+ */
+typedef struct {
+    uint32_t identifier;
+    uint32_t length;
+} RZDBRecordString;
+
+/**
+ *  A fixed-size record. Record n is complete only if its sequence is n + 1. A slot that was never written,
+ *  or that was being written when recording stopped or the process crashed, doesn't match and should be skipped.
+ */
+typedef struct {
+    // a monotonic time in nanoseconds
+    uint64_t timestamp;
+
+    // nanoseconds spent delivering, saturated at UINT32_MAX. 0 unless RZDB_RECORD_FLAG_DELIVERED is set.
+    uint32_t duration;
+
+    // a small number identifying the thread, assigned in order of each thread's first record
+    uint32_t thread;
+
+    // string IDs of the observed object's class, the key path, the target's class and the action. The action is
+    // the selector of a callback, or the bound key of a binding. Coalesced callbacks sent on commit have no
+    // observed class or key path, and change records have no target class or action.
+    uint32_t objectClass;
+    uint32_t keyPath;
+    uint32_t targetClass;
+    uint32_t action;
+
+    // the number of observers notified of a change record, saturated at UINT32_MAX
+    uint32_t fanout;
+
+    uint16_t flags;
+    uint16_t reserved;
+
+    // the record's number + 1. It is cleared before the other fields are written, and stored after them with release ordering.
+    uint64_t sequence;
+} RZDBRecord;
+
+/**
+ *  The string IDs of a record's observed class, key path, target class and action. RZDataBinding looks these up
+ *  when an observer is registered, so that appending a record never locks.
+ */
+typedef struct {
+    uint32_t objectClass;
+    uint32_t keyPath;
+    uint32_t targetClass;
+    uint32_t action;
+} RZDBRecordSite;
+
+#endif
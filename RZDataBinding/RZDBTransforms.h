@@ -27,6 +27,10 @@
 
 #import <Foundation/Foundation.h>
 
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+#import <CoreGraphics/CGGeometry.h>
+#endif
+
 #pragma mark - Definitions
 
 /**
@@ -38,6 +42,67 @@
  */
 typedef id (^RZDBKeyBindingTransform)(id value);
 
+/**
+ *  A reducer that combines the values of several key paths into a single object.
+ *
+ *  @param values The current values of the key paths, in order. Nil values are represented by NSNull.
+ *
+ *  @return The combined value. Ideally the returned value should depend solely on the input values.
+ *
+ *  @see RZDBDerivedValue
+ */
+typedef id (^RZDBKeyBindingReducer)(NSArray *values);
+
+/**
+ *  Typed transforms, which take and return unboxed values. Wrap them with rz_doubleTransform, rz_boolTransform or rz_rectTransform
+ *  to use them as an RZDBKeyBindingTransform.
+ */
+typedef double (^RZDBDoubleTransform)(double value);
+typedef BOOL (^RZDBBoolTransform)(BOOL value);
+
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+typedef CGRect (^RZDBRectTransform)(CGRect value);
+#endif
+
+#pragma mark - Typed Transforms
+
+/**
+ *  Returns a transform that applies a typed transform to [value doubleValue], and returns the result as an NSNumber.
+ *
+ *  When a double, float or CGFloat key is bound to a key of the same kind with this transform, or with a composition of
+ *  only double transforms, the values are read, transformed and set without ever being boxed.
+ */
+OBJC_EXTERN RZDBKeyBindingTransform rz_doubleTransform(RZDBDoubleTransform transform);
+
+/**
+ *  Returns a transform that applies a typed transform to [value boolValue], and returns the result as an NSNumber.
+ *  Like rz_doubleTransform, binding BOOL keys with it never boxes values.
+ */
+OBJC_EXTERN RZDBKeyBindingTransform rz_boolTransform(RZDBBoolTransform transform);
+
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+
+/**
+ *  Returns a transform that applies a typed transform to the CGRect in an NSValue, and returns the result as an NSValue.
+ *  Values that don't contain a CGRect, including nil, are transformed from CGRectZero.
+ *  Like rz_doubleTransform, binding CGRect keys with it never boxes values.
+ */
+OBJC_EXTERN RZDBKeyBindingTransform rz_rectTransform(RZDBRectTransform transform);
+
+#endif
+
+/**
+ *  Returns a transform that applies each of the given transforms in order, as a single evaluation.
+ *
+ *  Adjacent typed transforms pass their values to each other unboxed, as do kRZDBOneMinusTransform and kRZDBLogicalNegateTransform,
+ *  and compositions can themselves be composed. Only the input, and any value passed to or from an untyped transform, is ever boxed.
+ *  A binding whose transform is a composition of typed transforms of a single type never boxes values at all.
+ *
+ *  @param transforms An array of RZDBKeyBindingTransforms, which may include the kRZDB constants and the results of rz_doubleTransform,
+ *                    rz_boolTransform, rz_rectTransform and rz_composeTransforms.
+ */
+OBJC_EXTERN RZDBKeyBindingTransform rz_composeTransforms(NSArray *transforms);
+
 #pragma mark - Convenience Constants
 
 /**
@@ -50,6 +115,9 @@ OBJC_EXTERN RZDBKeyBindingTransform const kRZDBNilToZeroTransform;
  */
 OBJC_EXTERN RZDBKeyBindingTransform const kRZDBNilToOneTransform;
 
+// the CoreGraphics transforms are unavailable on platforms without CoreGraphics (e.g. GNUstep)
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+
 /**
  *  If value is nil, returns NSValue with CGSizeZero, otherwise returns value.
  */
@@ -65,13 +133,15 @@ OBJC_EXTERN RZDBKeyBindingTransform const kRZDBNilToCGRectZeroTransform;
  */
 OBJC_EXTERN RZDBKeyBindingTransform const kRZDBNilToCGRectNullTransform;
 
+#endif
+
 /**
- *  Returns @(![value boolValue])
+ *  Returns @(![value boolValue]). Applied unboxed when composed or bound to BOOL keys, like a typed transform.
  */
 OBJC_EXTERN RZDBKeyBindingTransform const kRZDBLogicalNegateTransform;
 
 /**
- *  Returns @(1.0 - [value doubleValue])
+ *  Returns @(1.0 - [value doubleValue]). Applied unboxed when composed or bound to double keys, like a typed transform.
  */
 OBJC_EXTERN RZDBKeyBindingTransform const kRZDBOneMinusTransform;
 
@@ -79,3 +149,18 @@ OBJC_EXTERN RZDBKeyBindingTransform const kRZDBOneMinusTransform;
  *  Returns @(~[value longLongValue])
  */
 OBJC_EXTERN RZDBKeyBindingTransform const kRZDBBitwiseComplementTransform;
+
+/**
+ *  Returns @(YES) if every value's boolValue is YES, treating NSNull as NO.
+ */
+OBJC_EXTERN RZDBKeyBindingReducer const kRZDBLogicalAndReducer;
+
+/**
+ *  Returns @(YES) if any value's boolValue is YES, treating NSNull as NO.
+ */
+OBJC_EXTERN RZDBKeyBindingReducer const kRZDBLogicalOrReducer;
+
+/**
+ *  Returns the sum of the values' doubleValues, treating NSNull as 0.
+ */
+OBJC_EXTERN RZDBKeyBindingReducer const kRZDBSumReducer;
@@ -25,10 +25,63 @@
 // OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
 // WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
+#import <objc/runtime.h>
+
+#if __has_include(<CoreGraphics/CGGeometry.h>)
 #import <CoreGraphics/CGGeometry.h>
+#endif
 
 #import "RZDBTransforms.h"
 
+static void* const kRZDBTransformPipelineKey = (void *)&kRZDBTransformPipelineKey;
+
+typedef NS_ENUM(uint8_t, RZDBTransformStageType) {
+    RZDBTransformStageTypeObject,
+    RZDBTransformStageTypeDouble,
+    RZDBTransformStageTypeBool,
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+    RZDBTransformStageTypeRect,
+#endif
+};
+
+// the unboxed value passed between adjacent typed stages
+typedef union {
+    double doubleValue;
+    BOOL boolValue;
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+    CGRect rectValue;
+#endif
+} RZDBTransformValue;
+
+#pragma mark - RZDBTransformPipeline interface
+
+// A composed transform: a flat list of stages, each of which is an RZDBKeyBindingTransform or a typed transform.
+// Values are only boxed or unboxed between adjacent stages of different types.
+@interface RZDBTransformPipeline : NSObject
+
+// returns the pipeline of a transform returned by one of the typed transform functions,
+// or a single stage pipeline for any other transform
++ (instancetype)pipelineForTransform:(RZDBKeyBindingTransform)transform;
+
+- (instancetype)initWithStages:(NSArray *)stages types:(const RZDBTransformStageType *)types;
+
+- (void)appendStages:(NSMutableArray *)stages types:(NSMutableData *)types;
+
+// the type encoding of the values the pipeline transforms without boxing, or NULL if it has stages of more than one type
+@property (assign, nonatomic, readonly) const char *valueEncoding;
+
+// returns a new transform block that owns the pipeline, and which may be passed back to pipelineForTransform:
+- (RZDBKeyBindingTransform)block;
+
+- (id)transformObject:(id)value;
+- (double)transformDouble:(double)value;
+- (BOOL)transformBool:(BOOL)value;
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+- (CGRect)transformRect:(CGRect)value;
+#endif
+
+@end
+
 RZDBKeyBindingTransform const kRZDBNilToZeroTransform = ^(id value) {
     return (value == nil) ? @(0) : value;
 };
@@ -37,6 +90,8 @@ RZDBKeyBindingTransform const kRZDBNilToOneTransform = ^(id value) {
     return (value == nil) ? @(1) : value;
 };
 
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+
 RZDBKeyBindingTransform const kRZDBNilToCGSizeZeroTransform = ^(id value) {
     if ( value == nil ) {
         value = [NSValue valueWithBytes:&CGSizeZero objCType:@encode(CGSize)];
@@ -58,6 +113,8 @@ RZDBKeyBindingTransform const kRZDBNilToCGRectNullTransform = ^(id value) {
     return value;
 };
 
+#endif
+
 RZDBKeyBindingTransform const kRZDBLogicalNegateTransform = ^(id value) {
     return @(![value boolValue]);
 };
@@ -69,3 +126,354 @@ RZDBKeyBindingTransform const kRZDBOneMinusTransform = ^(id value) {
 RZDBKeyBindingTransform const kRZDBBitwiseComplementTransform = ^(id value) {
     return @(~[value longLongValue]);
 };
+
+RZDBKeyBindingReducer const kRZDBLogicalAndReducer = ^id (NSArray *values) {
+    for ( id value in values ) {
+        if ( value == [NSNull null] || ![value boolValue] ) {
+            return @(NO);
+        }
+    }
+    return @(YES);
+};
+
+RZDBKeyBindingReducer const kRZDBLogicalOrReducer = ^id (NSArray *values) {
+    for ( id value in values ) {
+        if ( value != [NSNull null] && [value boolValue] ) {
+            return @(YES);
+        }
+    }
+    return @(NO);
+};
+
+RZDBKeyBindingReducer const kRZDBSumReducer = ^id (NSArray *values) {
+    double sum = 0.0;
+
+    for ( id value in values ) {
+        if ( value != [NSNull null] ) {
+            sum += [value doubleValue];
+        }
+    }
+    return @(sum);
+};
+
+#pragma mark - Typed Transforms
+
+RZDBKeyBindingTransform rz_doubleTransform(RZDBDoubleTransform transform)
+{
+    NSCParameterAssert(transform);
+
+    RZDBTransformStageType type = RZDBTransformStageTypeDouble;
+    return [[[RZDBTransformPipeline alloc] initWithStages:@[[transform copy]] types:&type] block];
+}
+
+RZDBKeyBindingTransform rz_boolTransform(RZDBBoolTransform transform)
+{
+    NSCParameterAssert(transform);
+
+    RZDBTransformStageType type = RZDBTransformStageTypeBool;
+    return [[[RZDBTransformPipeline alloc] initWithStages:@[[transform copy]] types:&type] block];
+}
+
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+
+RZDBKeyBindingTransform rz_rectTransform(RZDBRectTransform transform)
+{
+    NSCParameterAssert(transform);
+
+    RZDBTransformStageType type = RZDBTransformStageTypeRect;
+    return [[[RZDBTransformPipeline alloc] initWithStages:@[[transform copy]] types:&type] block];
+}
+
+#endif
+
+RZDBKeyBindingTransform rz_composeTransforms(NSArray *transforms)
+{
+    NSMutableArray *stages = [NSMutableArray array];
+    NSMutableData *types = [NSMutableData data];
+
+    // composed pipelines are flattened, so that adjacent typed stages of the composed transforms also pass values unboxed
+    for ( RZDBKeyBindingTransform transform in transforms ) {
+        RZDBTransformPipeline *pipeline = [RZDBTransformPipeline pipelineForTransform:transform];
+
+        [pipeline appendStages:stages types:types];
+    }
+
+    return [[[RZDBTransformPipeline alloc] initWithStages:stages types:types.bytes] block];
+}
+
+#pragma mark - Pipeline Helpers
+
+static id rz_boxTransformValue(const RZDBTransformValue *value, RZDBTransformStageType type)
+{
+    switch ( type ) {
+        case RZDBTransformStageTypeObject:
+            break;
+
+        case RZDBTransformStageTypeDouble:
+            return @(value->doubleValue);
+
+        case RZDBTransformStageTypeBool:
+            return @(value->boolValue);
+
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+        case RZDBTransformStageTypeRect:
+            return [NSValue valueWithBytes:&value->rectValue objCType:@encode(CGRect)];
+#endif
+    }
+
+    return nil;
+}
+
+static void rz_unboxTransformValue(RZDBTransformValue *value, id object, RZDBTransformStageType type)
+{
+    switch ( type ) {
+        case RZDBTransformStageTypeObject:
+            break;
+
+        case RZDBTransformStageTypeDouble:
+            value->doubleValue = [object doubleValue];
+            break;
+
+        case RZDBTransformStageTypeBool:
+            value->boolValue = [object boolValue];
+            break;
+
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+        case RZDBTransformStageTypeRect:
+            if ( [object isKindOfClass:[NSValue class]] && strcmp([object objCType], @encode(CGRect)) == 0 ) {
+                [object getValue:&value->rectValue];
+            }
+            else {
+                value->rectValue = CGRectZero;
+            }
+            break;
+#endif
+    }
+}
+
+// converts the value between the types of adjacent stages, with the same result as boxing it and unboxing it again
+static void rz_convertTransformValue(RZDBTransformValue *value, id __strong *object, RZDBTransformStageType fromType, RZDBTransformStageType toType)
+{
+    if ( fromType == RZDBTransformStageTypeDouble && toType == RZDBTransformStageTypeBool ) {
+        value->boolValue = (value->doubleValue != 0.0);
+    }
+    else if ( fromType == RZDBTransformStageTypeBool && toType == RZDBTransformStageTypeDouble ) {
+        value->doubleValue = value->boolValue ? 1.0 : 0.0;
+    }
+    else {
+        if ( fromType != RZDBTransformStageTypeObject ) {
+            *object = rz_boxTransformValue(value, fromType);
+        }
+
+        rz_unboxTransformValue(value, *object, toType);
+    }
+}
+
+#pragma mark - RZDBTransformPipeline implementation
+
+@implementation RZDBTransformPipeline {
+    NSArray *_stages;
+    NSUInteger _count;
+
+    // the stages and their types, read without messaging _stages when the pipeline runs
+    __unsafe_unretained id *_stageBlocks;
+    RZDBTransformStageType *_types;
+}
+
++ (instancetype)pipelineForTransform:(RZDBKeyBindingTransform)transform
+{
+    static RZDBTransformPipeline *s_oneMinusPipeline = nil;
+    static RZDBTransformPipeline *s_logicalNegatePipeline = nil;
+    static dispatch_once_t onceToken;
+
+    dispatch_once(&onceToken, ^{
+        RZDBTransformStageType doubleType = RZDBTransformStageTypeDouble;
+        RZDBTransformStageType boolType = RZDBTransformStageTypeBool;
+
+        s_oneMinusPipeline = [[self alloc] initWithStages:@[^double (double value) { return 1.0 - value; }] types:&doubleType];
+        s_logicalNegatePipeline = [[self alloc] initWithStages:@[^BOOL (BOOL value) { return !value; }] types:&boolType];
+    });
+
+    if ( transform == nil ) {
+        return nil;
+    }
+
+    RZDBTransformPipeline *pipeline = objc_getAssociatedObject(transform, kRZDBTransformPipelineKey);
+
+    // the constants can't be created by the typed transform functions, so they are recognized here instead
+    if ( pipeline == nil ) {
+        if ( transform == kRZDBOneMinusTransform ) {
+            pipeline = s_oneMinusPipeline;
+        }
+        else if ( transform == kRZDBLogicalNegateTransform ) {
+            pipeline = s_logicalNegatePipeline;
+        }
+        else {
+            RZDBTransformStageType objectType = RZDBTransformStageTypeObject;
+            pipeline = [[self alloc] initWithStages:@[[transform copy]] types:&objectType];
+        }
+    }
+
+    return pipeline;
+}
+
+- (instancetype)initWithStages:(NSArray *)stages types:(const RZDBTransformStageType *)types
+{
+    self = [super init];
+    if ( self != nil ) {
+        _stages = [stages copy];
+        _count = _stages.count;
+
+        _stageBlocks = (__unsafe_unretained id *)calloc(MAX(_count, 1), sizeof(id));
+        _types = (RZDBTransformStageType *)calloc(MAX(_count, 1), sizeof(RZDBTransformStageType));
+
+        [_stages getObjects:_stageBlocks range:NSMakeRange(0, _count)];
+
+        if ( _count > 0 ) {
+            memcpy(_types, types, _count * sizeof(RZDBTransformStageType));
+        }
+
+        _valueEncoding = [self homogeneousEncoding];
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    free(_stageBlocks);
+    free(_types);
+}
+
+- (RZDBKeyBindingTransform)block
+{
+    RZDBTransformPipeline *pipeline = self;
+
+    RZDBKeyBindingTransform block = [^id (id value) {
+        return [pipeline transformObject:value];
+    } copy];
+
+    // the block owns the pipeline, so the association doesn't need to retain it
+    objc_setAssociatedObject(block, kRZDBTransformPipelineKey, self, OBJC_ASSOCIATION_ASSIGN);
+
+    return block;
+}
+
+- (void)appendStages:(NSMutableArray *)stages types:(NSMutableData *)types
+{
+    [stages addObjectsFromArray:_stages];
+    [types appendBytes:_types length:_count * sizeof(RZDBTransformStageType)];
+}
+
+- (id)transformObject:(id)value
+{
+    RZDBTransformValue scalar = { 0 };
+    [self transformValue:&scalar object:&value type:RZDBTransformStageTypeObject];
+
+    return value;
+}
+
+- (double)transformDouble:(double)value
+{
+    RZDBTransformValue scalar = { .doubleValue = value };
+    id object = nil;
+    [self transformValue:&scalar object:&object type:RZDBTransformStageTypeDouble];
+
+    return scalar.doubleValue;
+}
+
+- (BOOL)transformBool:(BOOL)value
+{
+    RZDBTransformValue scalar = { .boolValue = value };
+    id object = nil;
+    [self transformValue:&scalar object:&object type:RZDBTransformStageTypeBool];
+
+    return scalar.boolValue;
+}
+
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+
+- (CGRect)transformRect:(CGRect)value
+{
+    RZDBTransformValue scalar = { .rectValue = value };
+    id object = nil;
+    [self transformValue:&scalar object:&object type:RZDBTransformStageTypeRect];
+
+    return scalar.rectValue;
+}
+
+#endif
+
+#pragma mark - private methods
+
+// runs each stage on the value, which starts and ends as the given type
+- (void)transformValue:(RZDBTransformValue *)value object:(id __strong *)object type:(RZDBTransformStageType)type
+{
+    RZDBTransformStageType currentType = type;
+
+    for ( NSUInteger i = 0; i < _count; i++ ) {
+        RZDBTransformStageType stageType = _types[i];
+
+        if ( stageType != currentType ) {
+            rz_convertTransformValue(value, object, currentType, stageType);
+            currentType = stageType;
+        }
+
+        switch ( stageType ) {
+            case RZDBTransformStageTypeObject:
+                *object = ((RZDBKeyBindingTransform)_stageBlocks[i])(*object);
+                break;
+
+            case RZDBTransformStageTypeDouble:
+                value->doubleValue = ((RZDBDoubleTransform)_stageBlocks[i])(value->doubleValue);
+                break;
+
+            case RZDBTransformStageTypeBool:
+                value->boolValue = ((RZDBBoolTransform)_stageBlocks[i])(value->boolValue);
+                break;
+
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+            case RZDBTransformStageTypeRect:
+                value->rectValue = ((RZDBRectTransform)_stageBlocks[i])(value->rectValue);
+                break;
+#endif
+        }
+    }
+
+    if ( currentType != type ) {
+        rz_convertTransformValue(value, object, currentType, type);
+    }
+}
+
+- (const char *)homogeneousEncoding
+{
+    if ( _count == 0 ) {
+        return NULL;
+    }
+
+    for ( NSUInteger i = 1; i < _count; i++ ) {
+        if ( _types[i] != _types[0] ) {
+            return NULL;
+        }
+    }
+
+    switch ( _types[0] ) {
+        case RZDBTransformStageTypeObject:
+            break;
+
+        case RZDBTransformStageTypeDouble:
+            return @encode(double);
+
+        case RZDBTransformStageTypeBool:
+            return @encode(BOOL);
+
+#if __has_include(<CoreGraphics/CGGeometry.h>)
+        case RZDBTransformStageTypeRect:
+            return @encode(CGRect);
+#endif
+    }
+
+    return NULL;
+}
+
+@end
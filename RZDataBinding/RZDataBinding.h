@@ -29,3 +29,6 @@
 #import "RZDBTransforms.h"
 #import "RZDBCoalesce.h"
 #import "NSObject+RZDataBinding.h"
+#import "RZDBKeyPath.h"
+#import "RZDBDerivedValue.h"
+#import "RZDBInstrumentation.h"
@@ -7,9 +7,16 @@
 
 @import XCTest;
 @import CoreGraphics.CGGeometry;
+@import ObjectiveC.runtime;
+
+#import <stdatomic.h>
 
 #import "RZDataBinding.h"
 
+#if RZDB_INSTRUMENTATION
+#import "RZDBRecordFormat.h"
+#endif
+
 @protocol TestProtocol <NSObject>
 
 - (NSString *)helloString;
@@ -21,9 +28,15 @@
 @property (copy, nonatomic) NSString *string;
 @property (assign, nonatomic) NSInteger callbackCalls;
 @property (assign, nonatomic) NSInteger setStringCalls;
+@property (copy, nonatomic) NSDictionary *lastChange;
+@property (assign, nonatomic) CGFloat number;
+@property (assign, nonatomic) CGRect rect;
+@property (strong, nonatomic) NSMutableArray *array;
+@property (strong, nonatomic) RZDBTestObject *child;
 
 - (void)changeCallback;
 - (void)changeCallbackWithDict:(NSDictionary *)dictionary;
+- (void)collectionChangeCallbackWithDict:(NSDictionary *)dictionary;
 
 @end
 
@@ -37,9 +50,32 @@
 - (void)changeCallbackWithDict:(NSDictionary *)dictionary
 {
     self.callbackCalls++;
+    self.lastChange = dictionary;
     self.string = dictionary[kRZDBChangeKeyNew];
 }
 
+- (void)collectionChangeCallbackWithDict:(NSDictionary *)dictionary
+{
+    self.callbackCalls++;
+    self.lastChange = dictionary;
+}
+
+// indexed accessors, so that mutableArrayValueForKey: mutations are reported as to-many changes
+- (void)insertObject:(id)object inArrayAtIndex:(NSUInteger)index
+{
+    [_array insertObject:object atIndex:index];
+}
+
+- (void)removeObjectFromArrayAtIndex:(NSUInteger)index
+{
+    [_array removeObjectAtIndex:index];
+}
+
+- (void)replaceObjectInArrayAtIndex:(NSUInteger)index withObject:(id)object
+{
+    [_array replaceObjectAtIndex:index withObject:object];
+}
+
 - (void)setString:(NSString *)string
 {
     _string = [string copy];
@@ -60,6 +96,55 @@
 
 @end
 
+// only used by testCallbackCacheInvalidation, which replaces its changeCallback implementation
+@interface RZDBSwizzledTestObject : RZDBTestObject
+
+@end
+
+@implementation RZDBSwizzledTestObject
+
+@end
+
+// only used by testConcurrentRegistration, whose callbacks may be sent on several threads at once
+@interface RZDBConcurrentTestObject : RZDBTestObject
+
+@property (assign, nonatomic, readonly) NSInteger callbackCount;
+
+@end
+
+@implementation RZDBConcurrentTestObject {
+    atomic_long _callbackCount;
+}
+
+- (void)changeCallback
+{
+    atomic_fetch_add_explicit(&_callbackCount, 1, memory_order_relaxed);
+}
+
+- (NSInteger)callbackCount
+{
+    return atomic_load_explicit(&_callbackCount, memory_order_relaxed);
+}
+
+@end
+
+// only used by testCoalesceOrder, which records the order its callbacks are delivered in
+@interface RZDBLoggingTestObject : RZDBTestObject
+
+@property (strong, nonatomic) NSMutableArray *log;
+
+@end
+
+@implementation RZDBLoggingTestObject
+
+- (void)changeCallbackWithDict:(NSDictionary *)dictionary
+{
+    self.callbackCalls++;
+    [self.log addObject:@[self, dictionary[kRZDBChangeKeyObject], dictionary[kRZDBChangeKeyKeyPath], dictionary[kRZDBChangeKeyNew]]];
+}
+
+@end
+
 @interface RZDBTests : XCTestCase
 
 @end
@@ -99,6 +184,52 @@
     XCTAssertTrue([observer.string isEqualToString:testObj.string], @"Strings should be equal because the callback is setting the property to the new object");
 }
 
+- (void)testChangeDictionary
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+
+    testObj.string = @"old";
+
+    [testObj rz_addTarget:observer action:@selector(changeCallbackWithDict:) forKeyPathChange:RZDB_KP_OBJ(testObj, string)];
+
+    testObj.string = @"new";
+
+    NSDictionary *expected = @{ kRZDBChangeKeyObject : testObj,
+                                kRZDBChangeKeyOld : @"old",
+                                kRZDBChangeKeyNew : @"new",
+                                kRZDBChangeKeyKeyPath : RZDB_KP_OBJ(testObj, string) };
+
+    XCTAssertEqualObjects(observer.lastChange, expected, @"Change dictionary has incorrect contents.");
+    XCTAssertEqualObjects([observer.lastChange mutableCopy], expected, @"Copied change dictionary has incorrect contents.");
+    XCTAssertEqualObjects(observer.lastChange[@"RZDBChangeNew"], @"new", @"Change dictionary lookup by an equal key failed.");
+}
+
+- (void)testToManyChangeDictionary
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+
+    testObj.array = [NSMutableArray arrayWithObjects:@"a", @"b", @"c", nil];
+
+    [testObj rz_addTarget:observer action:@selector(collectionChangeCallbackWithDict:) forKeyPathChange:RZDB_KP_OBJ(testObj, array)];
+
+    [[testObj mutableArrayValueForKey:RZDB_KP_OBJ(testObj, array)] insertObject:@"x" atIndex:1];
+
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyKind], @(NSKeyValueChangeInsertion), @"Change dictionary has incorrect kind.");
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyIndexes], [NSIndexSet indexSetWithIndex:1], @"Change dictionary has incorrect indexes.");
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyNew], @[@"x"], @"Change dictionary should contain only the inserted objects.");
+
+    [[testObj mutableArrayValueForKey:RZDB_KP_OBJ(testObj, array)] removeObjectAtIndex:0];
+
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyKind], @(NSKeyValueChangeRemoval), @"Change dictionary has incorrect kind.");
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyOld], @[@"a"], @"Change dictionary should contain only the removed objects.");
+
+    testObj.array = [NSMutableArray array];
+
+    XCTAssertNil(observer.lastChange[kRZDBChangeKeyKind], @"Setting the whole array shouldn't be reported as a to-many change.");
+}
+
 - (void)testCallbackCount
 {
     RZDBTestObject *obj1 = [RZDBTestObject new];
@@ -131,6 +262,71 @@
     XCTAssertTrue(observer.callbackCalls == 2, @"Callback called incorrect number of times. Expected:2 Actual:%i", (int)observer.callbackCalls);
 }
 
+- (void)testSharedObservation
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer1 = [RZDBTestObject new];
+    RZDBTestObject *observer2 = [RZDBTestObject new];
+    RZDBTestObject *observer3 = [RZDBTestObject new];
+
+    // the second registration requires new values, which the first registration didn't
+    [testObj rz_addTarget:observer1 action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(testObj, string)];
+    [testObj rz_addTarget:observer2 action:@selector(changeCallbackWithDict:) forKeyPathChange:RZDB_KP_OBJ(testObj, string)];
+    [observer3 rz_bindKey:RZDB_KP_OBJ(observer3, string) toKeyPath:RZDB_KP_OBJ(testObj, string) ofObject:testObj];
+
+    testObj.string = @"test";
+
+    XCTAssertTrue(observer1.callbackCalls == 1, @"Callback called incorrect number of times. Expected:1 Actual:%i", (int)observer1.callbackCalls);
+    XCTAssertTrue(observer2.callbackCalls == 1, @"Callback called incorrect number of times. Expected:1 Actual:%i", (int)observer2.callbackCalls);
+    XCTAssertTrue([observer2.string isEqualToString:@"test"], @"Shared observation did not provide the new value.");
+    XCTAssertTrue([observer3.string isEqualToString:@"test"], @"Bound key not equal when key path changed");
+
+    [testObj rz_removeTarget:observer1 action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(testObj, string)];
+    testObj.string = @"test2";
+
+    XCTAssertTrue(observer1.callbackCalls == 1, @"Callback called even after removal");
+    XCTAssertTrue(observer2.callbackCalls == 2, @"Removing one target affected another target of the same key path.");
+    XCTAssertTrue([observer3.string isEqualToString:@"test2"], @"Removing one target affected a binding to the same key path.");
+}
+
+- (void)testRemoveAllActions
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+    RZDBTestObject *otherObserver = [RZDBTestObject new];
+
+    [testObj rz_addTarget:observer action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(testObj, string)];
+    [testObj rz_addTarget:observer action:@selector(changeCallbackWithDict:) forKeyPathChange:RZDB_KP_OBJ(testObj, string)];
+    [testObj rz_addTarget:observer action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(testObj, setStringCalls)];
+    [testObj rz_addTarget:otherObserver action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(testObj, string)];
+
+    [testObj rz_removeTarget:observer action:NULL forKeyPathChange:RZDB_KP_OBJ(testObj, string)];
+
+    testObj.string = @"test";
+
+    // setting the string also changes setStringCalls, which is still observed
+    XCTAssertTrue(observer.callbackCalls == 1, @"Callback called incorrect number of times. Expected:1 Actual:%i", (int)observer.callbackCalls);
+    XCTAssertTrue(otherObserver.callbackCalls == 1, @"Removing a target affected another target of the same key path.");
+}
+
+- (void)testCallbackCacheInvalidation
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBSwizzledTestObject *observer = [RZDBSwizzledTestObject new];
+
+    [testObj rz_addTarget:observer action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(testObj, string)];
+
+    class_replaceMethod([RZDBSwizzledTestObject class], @selector(changeCallback), imp_implementationWithBlock(^(RZDBTestObject *obj) {
+        obj.callbackCalls += 10;
+    }), "v@:");
+
+    rz_invalidateCallbackCache();
+
+    testObj.string = @"test";
+
+    XCTAssertTrue(observer.callbackCalls == 10, @"Cached callback implementation was not invalidated.");
+}
+
 - (void)testAsynchronousRegistration
 {
     RZDBTestObject *testObj = [RZDBTestObject new];
@@ -152,6 +348,101 @@
     }
 }
 
+- (void)testConcurrentRegistration
+{
+    static const NSUInteger kThreadCount = 8;
+    static const NSUInteger kIterations = 2000;
+
+    RZDBTestObject *sharedObj = [RZDBTestObject new];
+    NSMutableArray *observers = [NSMutableArray array];
+
+    for ( NSUInteger i = 0; i < kThreadCount; i++ ) {
+        [observers addObject:[RZDBConcurrentTestObject new]];
+    }
+
+    dispatch_apply(kThreadCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t thread) {
+        RZDBConcurrentTestObject *observer = observers[thread];
+        RZDBTestObject *privateObj = [RZDBTestObject new];
+
+        for ( NSUInteger i = 0; i < kIterations; i++ ) {
+            @autoreleasepool {
+                // half the traffic contends on a shared object, the other half is thread local
+                RZDBTestObject *obj = (i % 2 == 0) ? sharedObj : privateObj;
+
+                [obj rz_addTarget:observer action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(obj, string)];
+                obj.string = @"test";
+                [obj rz_removeTarget:observer action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(obj, string)];
+            }
+        }
+    });
+
+    // every change an observer's own thread makes is delivered to it, and it may also see
+    // changes that other threads make to the shared object while it is registered there
+    NSInteger maxCallbackCalls = kIterations + (kThreadCount - 1) * (kIterations / 2);
+    NSArray *callbackCounts = [observers valueForKey:@"callbackCount"];
+
+    for ( NSNumber *callbackCount in callbackCounts ) {
+        XCTAssertGreaterThanOrEqual(callbackCount.integerValue, (NSInteger)kIterations, @"A change made while registered wasn't delivered.");
+        XCTAssertLessThanOrEqual(callbackCount.integerValue, maxCallbackCalls, @"An observer received a change while it wasn't registered.");
+    }
+
+    sharedObj.string = @"done";
+
+    XCTAssertEqualObjects([observers valueForKey:@"callbackCount"], callbackCounts, @"All observers should have been removed.");
+}
+
+- (void)testDeepHierarchyCleanup
+{
+    // build a 32 level deep chain of RZDBTestObject subclasses
+    static NSArray *deepClasses = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableArray *classes = [NSMutableArray array];
+        Class deepClass = [RZDBTestObject class];
+
+        for ( int i = 0; i < 32; i++ ) {
+            NSString *className = [NSString stringWithFormat:@"RZDBDeepTestObject%i", i];
+            Class subclass = objc_allocateClassPair(deepClass, className.UTF8String, 0);
+            objc_registerClassPair(subclass);
+
+            [classes addObject:subclass];
+            deepClass = subclass;
+        }
+
+        deepClasses = classes;
+    });
+
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+
+    [testObj rz_addTarget:observer action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(testObj, string)];
+
+    // registering objects of each class swizzles dealloc once per hierarchy, so cleanup must still run at every level
+    for ( Class deepClass in deepClasses ) {
+        __weak RZDBTestObject *weakTarget = nil;
+        __weak RZDBTestObject *weakSource = nil;
+
+        @autoreleasepool {
+            RZDBTestObject *target = [deepClass new];
+            RZDBTestObject *source = [deepClass new];
+
+            [testObj rz_addTarget:target action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(testObj, string)];
+            [source rz_addTarget:observer action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(source, string)];
+
+            weakTarget = target;
+            weakSource = source;
+        }
+
+        XCTAssertNil(weakTarget, @"Add target prevented deallocation of a %@.", deepClass);
+        XCTAssertNil(weakSource, @"Add target prevented deallocation of a %@.", deepClass);
+    }
+
+    observer.callbackCalls = 0;
+    testObj.string = @"test";
+
+    XCTAssertTrue(observer.callbackCalls == 1, @"Deallocated targets of every class should have been cleaned up. Expected:1 Actual:%i", (int)observer.callbackCalls);
+}
+
 - (void)testSimpleCoalesce
 {
     RZDBTestObject *testObj = [RZDBTestObject new];
@@ -186,6 +477,120 @@
     XCTAssertTrue([observer.string isEqualToString:@"test2"], @"Coalesced callback called with incorrect final value.");
 }
 
+- (void)testCoalesceOption
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+
+    [testObj rz_addTarget:observer action:@selector(changeCallbackWithDict:) forKeyPathChanges:@[RZDB_KP_OBJ(testObj, string), RZDB_KP_OBJ(testObj, callbackCalls)] options:RZDBObservationOptionCoalesce];
+
+    [RZDBCoalesce coalesceBlock:^{
+        testObj.string = @"test";
+        testObj.string = @"test2";
+    }];
+
+    XCTAssertTrue(observer.callbackCalls == 1, @"Callback called incorrect number of times. Expected:1 Actual:%i", (int)observer.callbackCalls);
+    XCTAssertTrue([observer.string isEqualToString:@"test2"], @"Coalesced callback called with incorrect final value.");
+
+    testObj.string = @"test3";
+
+    XCTAssertTrue(observer.callbackCalls == 2, @"Callback should be sent immediately outside of a coalesce.");
+}
+
+- (void)testCoalesceToManyChanges
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+
+    testObj.array = [NSMutableArray arrayWithObjects:@"a", @"b", @"c", nil];
+
+    [testObj rz_addTarget:observer action:@selector(collectionChangeCallbackWithDict:) forKeyPathChange:RZDB_KP_OBJ(testObj, array) options:RZDBObservationOptionCoalesce];
+
+    NSMutableArray *array = [testObj mutableArrayValueForKey:RZDB_KP_OBJ(testObj, array)];
+
+    [RZDBCoalesce coalesceBlock:^{
+        [array insertObject:@"x" atIndex:0];
+        [array insertObject:@"y" atIndex:2];
+    }];
+
+    NSMutableIndexSet *expectedIndexes = [NSMutableIndexSet indexSetWithIndex:0];
+    [expectedIndexes addIndex:2];
+
+    XCTAssertTrue(observer.callbackCalls == 1, @"Callback called incorrect number of times. Expected:1 Actual:%i", (int)observer.callbackCalls);
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyKind], @(NSKeyValueChangeInsertion), @"Successive insertions should merge into one insertion.");
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyIndexes], expectedIndexes, @"Merged insertion has incorrect indexes.");
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyNew], (@[@"x", @"y"]), @"Merged insertion has incorrect objects.");
+
+    observer.callbackCalls = 0;
+
+    // [x, a, y, b, c] -> [a, y, c, z]
+    [RZDBCoalesce coalesceBlock:^{
+        [array removeObjectAtIndex:0];
+        [array removeObjectAtIndex:2];
+        [array addObject:@"z"];
+    }];
+
+    XCTAssertTrue(observer.callbackCalls == 1, @"Callback called incorrect number of times. Expected:1 Actual:%i", (int)observer.callbackCalls);
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyKind], @(NSKeyValueChangeSetting), @"Mixed changes should merge into a net change.");
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyNew], (@[@"a", @"y", @"c", @"z"]), @"Net change should contain the final array.");
+
+    NSMutableIndexSet *expectedRemoved = [NSMutableIndexSet indexSetWithIndex:0];
+    [expectedRemoved addIndex:3];
+
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyRemovedIndexes], expectedRemoved, @"Net change has incorrect removed indexes.");
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyInsertedIndexes], [NSIndexSet indexSetWithIndex:3], @"Net change has incorrect inserted indexes.");
+}
+
+- (void)testCoalesceOrder
+{
+    NSMutableArray *log = [NSMutableArray array];
+    NSMutableArray *testObjects = [NSMutableArray array];
+    NSMutableArray *observers = [NSMutableArray array];
+
+    for ( NSUInteger i = 0; i < 8; i++ ) {
+        RZDBLoggingTestObject *observer = [RZDBLoggingTestObject new];
+        observer.log = log;
+
+        [testObjects addObject:[RZDBTestObject new]];
+        [observers addObject:observer];
+    }
+
+    for ( RZDBTestObject *testObj in testObjects ) {
+        for ( RZDBLoggingTestObject *observer in observers ) {
+            [testObj rz_addTarget:observer action:@selector(changeCallbackWithDict:) forKeyPathChanges:@[RZDB_KP_OBJ(testObj, string), RZDB_KP_OBJ(testObj, number)] options:RZDBObservationOptionCoalesce];
+        }
+    }
+
+    // each target/key path pair is delivered once, in the order it first changed, with its latest value
+    NSMutableArray *expectedLog = [NSMutableArray array];
+
+    for ( RZDBTestObject *testObj in testObjects.reverseObjectEnumerator ) {
+        for ( RZDBLoggingTestObject *observer in observers ) {
+            [expectedLog addObject:@[observer, testObj, RZDB_KP_OBJ(testObj, string), @"1"]];
+        }
+
+        for ( RZDBLoggingTestObject *observer in observers ) {
+            [expectedLog addObject:@[observer, testObj, RZDB_KP_OBJ(testObj, number), @2]];
+        }
+    }
+
+    [RZDBCoalesce coalesceBlock:^{
+        for ( NSUInteger pass = 0; pass < 2; pass++ ) {
+            for ( RZDBTestObject *testObj in testObjects.reverseObjectEnumerator ) {
+                testObj.string = [NSString stringWithFormat:@"%lu", (unsigned long)pass];
+                testObj.number = pass + 1;
+            }
+        }
+    }];
+
+    XCTAssertEqual(log.count, expectedLog.count, @"Repeated changes to the same target and key path should be delivered once.");
+    XCTAssertEqualObjects(log, expectedLog, @"Coalesced callbacks should be delivered in the order they were first sent.");
+
+    for ( RZDBLoggingTestObject *observer in observers ) {
+        XCTAssertTrue(observer.callbackCalls == 2 * (NSInteger)testObjects.count, @"Callback called incorrect number of times. Expected:%i Actual:%i", 2 * (int)testObjects.count, (int)observer.callbackCalls);
+    }
+}
+
 - (void)testNestedCoalesce
 {
     RZDBTestObject *testObj = [RZDBTestObject new];
@@ -246,6 +651,166 @@
     }];
 }
 
+- (void)testQueueDelivery
+{
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Delivered"];
+
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+    RZDBTestObject *boundObj = [RZDBTestObject new];
+
+    testObj.string = @"first";
+
+    [testObj rz_addTarget:observer action:@selector(changeCallbackWithDict:) forKeyPathChanges:@[RZDB_KP_OBJ(testObj, string)] options:RZDBObservationOptionNone queue:dispatch_get_main_queue()];
+    [boundObj rz_bindKey:RZDB_KP_OBJ(boundObj, string) toKeyPath:RZDB_KP_OBJ(testObj, string) ofObject:testObj withTransform:nil queue:dispatch_get_main_queue()];
+
+    for ( NSUInteger i = 0; i < 100; i++ ) {
+        testObj.string = [NSString stringWithFormat:@"%lu", (unsigned long)i];
+    }
+
+    XCTAssertTrue(observer.callbackCalls == 0, @"Callbacks should be delivered asynchronously.");
+    XCTAssertEqualObjects(boundObj.string, @"first", @"Bindings should be updated asynchronously.");
+
+    // enqueued after the batch, so runs after it is delivered
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [expectation fulfill];
+    });
+
+    [self waitForExpectationsWithTimeout:5 handler:^(NSError *error) {
+        XCTAssertTrue(observer.callbackCalls == 1, @"Changes should be batched into a single callback. Expected:1 Actual:%i", (int)observer.callbackCalls);
+        XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyOld], @"first", @"Batched change should have the oldest old value.");
+        XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyNew], @"99", @"Batched change should have the latest new value.");
+        XCTAssertEqualObjects(boundObj.string, @"99", @"Bound key should be set to the latest value.");
+        XCTAssertTrue(boundObj.setStringCalls == 2, @"Bound key should be set once when bound, and once per batch.");
+    }];
+}
+
+- (void)testThrottleAndDebounce
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *throttledObserver = [RZDBTestObject new];
+    RZDBTestObject *debouncedObserver = [RZDBTestObject new];
+
+    testObj.string = @"first";
+
+    // the intervals are long enough that every change below is made within one of them, even on a slow machine
+    [testObj rz_addTarget:throttledObserver action:@selector(changeCallbackWithDict:) forKeyPathChanges:@[RZDB_KP_OBJ(testObj, string)] options:RZDBObservationOptionThrottle interval:1.0 queue:nil];
+    [testObj rz_addTarget:debouncedObserver action:@selector(changeCallbackWithDict:) forKeyPathChanges:@[RZDB_KP_OBJ(testObj, string)] options:RZDBObservationOptionDebounce interval:1.0 queue:nil];
+
+    // the callbacks set each observer's string to the delivered value
+    [self keyValueObservingExpectationForObject:throttledObserver keyPath:RZDB_KP_OBJ(throttledObserver, string) expectedValue:@"99"];
+    [self keyValueObservingExpectationForObject:debouncedObserver keyPath:RZDB_KP_OBJ(debouncedObserver, string) expectedValue:@"99"];
+
+    for ( NSUInteger i = 0; i < 100; i++ ) {
+        testObj.string = [NSString stringWithFormat:@"%lu", (unsigned long)i];
+    }
+
+    XCTAssertTrue(debouncedObserver.callbackCalls == 0, @"Debounced callbacks should wait for the interval to end.");
+
+    [self waitForExpectationsWithTimeout:30 handler:^(NSError *error) {
+        // the first change is delivered right away, and the rest are delivered together when the interval ends
+        XCTAssertTrue(throttledObserver.callbackCalls == 2, @"Throttled callback called incorrect number of times. Expected:2 Actual:%i", (int)throttledObserver.callbackCalls);
+        XCTAssertEqualObjects(throttledObserver.lastChange[kRZDBChangeKeyOld], @"0", @"Throttled change should have the earliest old value of the interval.");
+        XCTAssertEqualObjects(throttledObserver.lastChange[kRZDBChangeKeyNew], @"99", @"Throttled change should have the latest new value.");
+
+        XCTAssertTrue(debouncedObserver.callbackCalls == 1, @"Debounced callback called incorrect number of times. Expected:1 Actual:%i", (int)debouncedObserver.callbackCalls);
+        XCTAssertEqualObjects(debouncedObserver.lastChange[kRZDBChangeKeyOld], @"first", @"Debounced change should have the earliest old value.");
+    }];
+}
+
+#if RZDB_INSTRUMENTATION
+- (void)testInstrumentation
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+
+    [RZDBInstrumentation reset];
+
+    [testObj rz_addTarget:observer action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(testObj, string) options:RZDBObservationOptionCoalesce];
+
+    testObj.string = @"test";
+
+    [RZDBCoalesce coalesceBlock:^{
+        testObj.string = @"1";
+        testObj.string = @"2";
+        testObj.string = @"3";
+    }];
+
+    NSDictionary *statistics = [[RZDBInstrumentation snapshot] filteredArrayUsingPredicate:[NSPredicate predicateWithBlock:^BOOL(NSDictionary *stats, NSDictionary *bindings) {
+        return [stats[kRZDBStatisticsKeyKeyPath] isEqualToString:RZDB_KP_OBJ(testObj, string)] && stats[kRZDBStatisticsKeyTargetClass] == [RZDBTestObject class];
+    }]].firstObject;
+
+    XCTAssertEqualObjects(statistics[kRZDBStatisticsKeyObjectClass], [RZDBTestObject class], @"Statistics should use the observed object's class, not its KVO subclass.");
+    XCTAssertEqualObjects(statistics[kRZDBStatisticsKeyNotificationCount], @4, @"Every notification should be counted, including coalesced ones.");
+    XCTAssertEqualObjects([statistics[kRZDBStatisticsKeyLatencyHistogram] valueForKeyPath:@"@sum.self"], @1, @"Only the callback sent outside the coalesce should be timed.");
+    XCTAssertEqual([RZDBInstrumentation coalescedNotificationCount], (NSUInteger)2, @"Two of the three coalesced notifications should have been saved.");
+
+    [RZDBInstrumentation reset];
+
+    XCTAssertEqual([RZDBInstrumentation snapshot].count, (NSUInteger)0, @"Reset should clear all statistics.");
+}
+
+- (void)testRecording
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:@"RZDBTests.rzdb"];
+
+    [testObj rz_addTarget:observer action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(testObj, string) options:RZDBObservationOptionCoalesce];
+
+    XCTAssertTrue([RZDBInstrumentation startRecordingToFile:path capacity:3], @"Recording should start.");
+
+    // a change and its delivery, then two changes whose callbacks are coalesced into one sent on commit
+    testObj.string = @"test";
+
+    [RZDBCoalesce coalesceBlock:^{
+        testObj.string = @"1";
+        testObj.string = @"2";
+    }];
+
+    [RZDBInstrumentation stopRecording];
+
+    testObj.string = @"stopped";
+
+    NSData *data = [NSData dataWithContentsOfFile:path];
+    const RZDBRecordFileHeader *header = data.bytes;
+
+    XCTAssertTrue(memcmp(header->magic, RZDB_RECORD_MAGIC, sizeof(RZDB_RECORD_MAGIC)) == 0, @"Recording should start with the magic string.");
+    XCTAssertEqual(header->recordCapacity, (uint64_t)4, @"Capacity should be rounded up to a power of two.");
+    XCTAssertEqual(header->recordCount, (uint64_t)7, @"Every event before stopping should be recorded, and none after.");
+
+    // the ring has wrapped, so the last 4 of the 7 records are in slots 3, 0, 1, 2
+    const RZDBRecord *records = (const RZDBRecord *)((const char *)data.bytes + header->recordOffset);
+
+    XCTAssertEqual(records[0].flags, (uint16_t)RZDB_RECORD_FLAG_CHANGE, @"Changes should be recorded.");
+    XCTAssertEqual(records[0].fanout, (uint32_t)1, @"Changes should record the number of observers.");
+    XCTAssertEqual(records[1].flags, (uint16_t)RZDB_RECORD_FLAG_COALESCED, @"Coalesced callbacks should be recorded.");
+    XCTAssertEqual(records[2].flags, (uint16_t)(RZDB_RECORD_FLAG_DELIVERED | RZDB_RECORD_FLAG_COALESCED), @"Callbacks sent on commit should be recorded.");
+    XCTAssertEqual(records[1].action, records[2].action, @"Coalesced and committed callbacks should have the same action ID.");
+
+    for ( uint64_t n = 3; n < 7; n++ ) {
+        XCTAssertEqual(records[n % 4].sequence, n + 1, @"Each complete record should be stamped with its number + 1.");
+    }
+
+    NSString *action = nil;
+    const char *strings = (const char *)data.bytes + header->stringOffset;
+
+    for ( uint64_t offset = 0; offset < header->stringLength; ) {
+        const RZDBRecordString *entry = (const RZDBRecordString *)(strings + offset);
+
+        if ( entry->identifier == records[1].action ) {
+            action = @(strings + offset + sizeof(RZDBRecordString));
+        }
+
+        offset += (sizeof(RZDBRecordString) + entry->length + 1 + 3) & ~3ULL;
+    }
+
+    XCTAssertEqualObjects(action, NSStringFromSelector(@selector(changeCallback)), @"String IDs interned before recording should be written to the recording.");
+
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+}
+#endif
+
 - (void)testKeyBinding
 {
     RZDBTestObject *testObj = [RZDBTestObject new];
@@ -264,6 +829,173 @@
     XCTAssertTrue([observer.string isEqualToString:@"test2"], @"String shouldn't change after keys are unbound");
 }
 
+- (void)testTypedKeyBinding
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+    RZDBTestObject *chainedObserver = [RZDBTestObject new];
+
+    testObj.number = 0.5;
+    testObj.rect = CGRectMake(1.0f, 2.0f, 3.0f, 4.0f);
+
+    [observer rz_bindKey:RZDB_KP_OBJ(observer, number) toKeyPath:RZDB_KP_OBJ(testObj, number) ofObject:testObj];
+    [observer rz_bindKey:RZDB_KP_OBJ(observer, rect) toKeyPath:RZDB_KP_OBJ(testObj, rect) ofObject:testObj];
+
+    XCTAssertTrue(observer.number == 0.5, @"Bound keys not equal on initial binding");
+    XCTAssertTrue(CGRectEqualToRect(observer.rect, testObj.rect), @"Bound keys not equal on initial binding");
+
+    // setting the bound key directly must still send KVO notifications for the bound key
+    [observer rz_addTarget:chainedObserver action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(observer, number)];
+
+    testObj.number = 0.75;
+    testObj.number = 0.75;
+    testObj.rect = CGRectZero;
+
+    XCTAssertTrue(observer.number == 0.75, @"Bound key not equal when key path changed");
+    XCTAssertTrue(CGRectEqualToRect(observer.rect, CGRectZero), @"Bound key not equal when key path changed");
+    XCTAssertTrue(chainedObserver.callbackCalls == 1, @"Callback called incorrect number of times. Expected:1 Actual:%i", (int)chainedObserver.callbackCalls);
+
+    // values equal by isEqual: must not call the setter, as with the KVC fallback
+    testObj.number = 0.0;
+    testObj.number = -0.0;
+    testObj.number = NAN;
+    testObj.number = -NAN;
+
+    XCTAssertTrue(chainedObserver.callbackCalls == 3, @"Setter should be skipped for -0.0 and for NaN with a different payload. Expected:3 Actual:%i", (int)chainedObserver.callbackCalls);
+}
+
+- (void)testCompiledKeyPath
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    testObj.string = @"test";
+    testObj.callbackCalls = 5;
+
+    RZDBKeyPath *keyPath = [RZDBKeyPath keyPathWithString:RZDB_KP_OBJ(testObj, string.length) forClass:[RZDBTestObject class]];
+
+    XCTAssertEqualObjects(keyPath, @"string.length", @"Compiled key path should be equal to its string.");
+    XCTAssertTrue(keyPath == [RZDBKeyPath keyPathWithString:@"string.length" forClass:[RZDBTestObject class]], @"Compiled key paths should be cached.");
+    XCTAssertEqualObjects([keyPath valueForObject:testObj], @(4), @"Compiled key path returned incorrect value.");
+
+    RZDBKeyPath *scalarKeyPath = [RZDBKeyPath keyPathWithString:RZDB_KP_OBJ(testObj, callbackCalls) forClass:[RZDBTestObject class]];
+    XCTAssertEqualObjects([scalarKeyPath valueForObject:testObj], @(5), @"Compiled key path returned incorrect value.");
+
+    RZDBTestObject *observer = [RZDBTestObject new];
+
+    [observer rz_bindKey:RZDB_KP_OBJ(observer, callbackCalls) toKeyPath:keyPath ofObject:testObj];
+    XCTAssertTrue(observer.callbackCalls == 4, @"Binding to a compiled key path failed.");
+
+    testObj.string = @"test2";
+    XCTAssertTrue(observer.callbackCalls == 5, @"Binding to a compiled key path failed.");
+}
+
+- (void)testBatchKeyBinding
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+
+    testObj.string = @"test";
+    testObj.number = 0.5;
+
+    [observer rz_bindKeysToKeyPaths:@{ RZDB_KP_OBJ(observer, string) : RZDB_KP_OBJ(testObj, string),
+                                       RZDB_KP_OBJ(observer, number) : RZDB_KP_OBJ(testObj, number) } ofObject:testObj];
+
+    XCTAssertTrue([observer.string isEqualToString:@"test"] && observer.number == 0.5, @"Bound keys not equal on initial binding");
+
+    testObj.string = @"test2";
+    testObj.number = 0.25;
+
+    XCTAssertTrue([observer.string isEqualToString:@"test2"] && observer.number == 0.25, @"Bound keys not equal when key paths changed");
+
+    [observer rz_unbindKey:RZDB_KP_OBJ(observer, string) fromKeyPath:RZDB_KP_OBJ(testObj, string) ofObject:testObj];
+    testObj.string = @"test3";
+
+    XCTAssertTrue([observer.string isEqualToString:@"test2"], @"String shouldn't change after keys are unbound");
+}
+
+- (void)testArrayBinding
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+    RZDBTestObject *chained = [RZDBTestObject new];
+
+    testObj.array = [NSMutableArray arrayWithObjects:@"a", @"b", nil];
+
+    [observer rz_bindArrayKey:RZDB_KP_OBJ(observer, array) toKeyPath:RZDB_KP_OBJ(testObj, array) ofObject:testObj];
+    [observer rz_addTarget:chained action:@selector(collectionChangeCallbackWithDict:) forKeyPathChange:RZDB_KP_OBJ(observer, array)];
+
+    XCTAssertEqualObjects(observer.array, testObj.array, @"Bound arrays not equal on initial binding");
+    XCTAssertTrue(observer.array != testObj.array, @"Bound array should be a copy");
+
+    NSMutableArray *array = [testObj mutableArrayValueForKey:RZDB_KP_OBJ(testObj, array)];
+
+    [array insertObject:@"c" atIndex:1];
+    XCTAssertEqualObjects(chained.lastChange[kRZDBChangeKeyKind], @(NSKeyValueChangeInsertion), @"Insertion should be applied to only the inserted index.");
+
+    [array replaceObjectAtIndex:0 withObject:@"d"];
+    XCTAssertEqualObjects(chained.lastChange[kRZDBChangeKeyKind], @(NSKeyValueChangeReplacement), @"Replacement should be applied to only the replaced index.");
+
+    [array removeObjectAtIndex:2];
+    XCTAssertEqualObjects(chained.lastChange[kRZDBChangeKeyKind], @(NSKeyValueChangeRemoval), @"Removal should be applied to only the removed index.");
+
+    XCTAssertEqualObjects(observer.array, (@[@"d", @"c"]), @"Bound arrays not equal after to-many changes");
+
+    testObj.array = [NSMutableArray arrayWithObject:@"e"];
+    XCTAssertEqualObjects(observer.array, testObj.array, @"Bound arrays not equal after setting the array");
+
+    [observer rz_unbindKey:RZDB_KP_OBJ(observer, array) fromKeyPath:RZDB_KP_OBJ(testObj, array) ofObject:testObj];
+    [[testObj mutableArrayValueForKey:RZDB_KP_OBJ(testObj, array)] addObject:@"f"];
+
+    XCTAssertEqualObjects(observer.array, (@[@"e"]), @"Array shouldn't change after keys are unbound");
+}
+
+- (void)testDerivedValue
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+
+    testObj.string = @"a";
+    testObj.number = 1.0;
+
+    __block NSInteger reductions = 0;
+
+    RZDBDerivedValue *derived = [RZDBDerivedValue derivedValueWithKeyPaths:@[RZDB_KP_OBJ(testObj, string), RZDB_KP_OBJ(testObj, number)] ofObject:testObj reducer:^id (NSArray *values) {
+        reductions++;
+        return [NSString stringWithFormat:@"%@%@", values[0], values[1]];
+    }];
+
+    testObj.string = @"b";
+    testObj.number = 2.0;
+
+    XCTAssertTrue(reductions == 0, @"An unobserved derived value shouldn't be computed until it is read.");
+    XCTAssertEqualObjects(derived.value, @"b2", @"Derived value is incorrect.");
+    XCTAssertEqualObjects(derived.value, @"b2", @"Derived value is incorrect.");
+    XCTAssertTrue(reductions == 1, @"Derived value should be memoized. Expected:1 Actual:%i", (int)reductions);
+
+    [derived rz_addTarget:observer action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(derived, value)];
+
+    reductions = 0;
+    testObj.string = @"c";
+
+    XCTAssertTrue(reductions == 1 && observer.callbackCalls == 1, @"An observed derived value should be recomputed when its inputs change.");
+    XCTAssertEqualObjects(derived.value, @"c2", @"Derived value is incorrect.");
+
+    testObj.string = @"c";
+
+    XCTAssertTrue(observer.callbackCalls == 1, @"Observers shouldn't be notified if the derived value is unchanged.");
+
+    reductions = 0;
+
+    [RZDBCoalesce coalesceBlock:^{
+        testObj.string = @"d";
+        testObj.number = 3.0;
+        testObj.string = @"e";
+    }];
+
+    XCTAssertTrue(reductions == 1, @"Derived value should be recomputed once when the coalesce is committed. Expected:1 Actual:%i", (int)reductions);
+    XCTAssertTrue(observer.callbackCalls == 2, @"Observers should be notified once when the coalesce is committed.");
+    XCTAssertEqualObjects(derived.value, @"e3", @"Derived value is incorrect.");
+}
+
 - (void)testBindingEqualityCheck
 {
     RZDBTestObject *testObj = [RZDBTestObject new];
@@ -314,6 +1046,97 @@
     XCTAssertTrue([obj3.string isEqualToString:obj2.string] && [obj2.string isEqualToString:obj1.string], @"Binding chain failed--values not equal");
 }
 
+- (void)testOrderedPropagation
+{
+    RZDBTestObject *obj1 = [RZDBTestObject new];
+    RZDBTestObject *obj2 = [RZDBTestObject new];
+    RZDBTestObject *obj3 = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+    RZDBTestObject *callbackTarget = [RZDBTestObject new];
+
+    // a diamond: obj3 depends on obj1 both directly, and through obj2
+    [obj2 rz_bindKey:RZDB_KP_OBJ(obj2, string) toKeyPath:RZDB_KP_OBJ(obj1, string) ofObject:obj1 withTransform:nil options:RZDBObservationOptionOrdered interval:0.0 queue:nil];
+
+    [obj3 rz_bindKey:RZDB_KP_OBJ(obj3, number) toKeyPath:RZDB_KP_OBJ(obj1, string) ofObject:obj1 withTransform:^id (id value) {
+        return @([value length]);
+    } options:RZDBObservationOptionOrdered interval:0.0 queue:nil];
+
+    [obj3 rz_bindKey:RZDB_KP_OBJ(obj3, string) toKeyPath:RZDB_KP_OBJ(obj2, string) ofObject:obj2 withTransform:nil options:RZDBObservationOptionOrdered interval:0.0 queue:nil];
+
+    __block NSInteger reductions = 0;
+    __block BOOL consistent = YES;
+
+    RZDBDerivedValue *derived = [RZDBDerivedValue derivedValueWithKeyPaths:@[RZDB_KP_OBJ(obj3, string), RZDB_KP_OBJ(obj3, number)] ofObject:obj3 reducer:^id (NSArray *values) {
+        NSUInteger length = [values[0] isKindOfClass:[NSString class]] ? [values[0] length] : 0;
+
+        reductions++;
+        consistent = consistent && (length == [values[1] unsignedIntegerValue]);
+
+        return values[0];
+    }];
+
+    [derived rz_addTarget:observer action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(derived, value)];
+    [obj3 rz_addTarget:callbackTarget action:@selector(changeCallback) forKeyPathChanges:@[RZDB_KP_OBJ(obj3, string), RZDB_KP_OBJ(obj3, number)] options:RZDBObservationOptionOrdered];
+
+    obj1.string = @"test";
+
+    XCTAssertEqualObjects(obj3.string, @"test", @"Ordered binding chain failed to propagate.");
+    XCTAssertTrue(obj3.number == 4.0f, @"Ordered binding failed to propagate.");
+    XCTAssertTrue(obj3.setStringCalls == 1, @"Each ordered binding should be set exactly once. Expected:1 Actual:%i", (int)obj3.setStringCalls);
+
+    XCTAssertTrue(consistent, @"A derived value was computed from inconsistent intermediate values.");
+    XCTAssertTrue(reductions == 1 && observer.callbackCalls == 1, @"An observed derived value should be recomputed once per propagating change.");
+    XCTAssertTrue(callbackTarget.callbackCalls == 1, @"Ordered callbacks should be sent once per propagating change. Expected:1 Actual:%i", (int)callbackTarget.callbackCalls);
+}
+
+- (void)testSuspendResume
+{
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+    RZDBTestObject *boundObj = [RZDBTestObject new];
+
+    testObj.string = @"a";
+
+    [testObj rz_addTarget:observer action:@selector(changeCallbackWithDict:) forKeyPathChange:RZDB_KP_OBJ(testObj, string)];
+    [boundObj rz_bindKey:RZDB_KP_OBJ(boundObj, string) toKeyPath:RZDB_KP_OBJ(testObj, string) ofObject:testObj];
+
+    [observer rz_suspendCallbacks];
+    [observer rz_suspendCallbacks];
+
+    testObj.string = @"b";
+    testObj.string = @"c";
+
+    XCTAssertTrue(observer.callbackCalls == 0, @"Callbacks shouldn't be sent to a suspended target.");
+    XCTAssertEqualObjects(boundObj.string, @"c", @"Suspending a target shouldn't affect other targets.");
+
+    [observer rz_resumeCallbacks];
+
+    XCTAssertTrue(observer.callbackCalls == 0, @"Callbacks shouldn't be sent until every suspension is resumed.");
+
+    [observer rz_resumeCallbacks];
+
+    XCTAssertTrue(observer.callbackCalls == 1, @"Each changed key path should be delivered once on resume. Expected:1 Actual:%i", (int)observer.callbackCalls);
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyOld], @"a", @"Resumed change should have the earliest old value.");
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyNew], @"c", @"Resumed change should have the latest new value.");
+
+    [testObj rz_suspendObservers];
+
+    testObj.string = @"d";
+    testObj.string = @"e";
+
+    XCTAssertTrue(observer.callbackCalls == 1 && [boundObj.string isEqualToString:@"c"], @"Changes of a suspended object shouldn't be delivered.");
+
+    [testObj rz_resumeObservers];
+
+    XCTAssertTrue(observer.callbackCalls == 2, @"Each changed key path should be delivered once on resume. Expected:2 Actual:%i", (int)observer.callbackCalls);
+    XCTAssertEqualObjects(boundObj.string, @"e", @"Bindings should be updated on resume.");
+
+    [testObj rz_resumeObservers];
+    testObj.string = @"f";
+
+    XCTAssertTrue(observer.callbackCalls == 3, @"An unbalanced resume should have no effect.");
+}
+
 - (void)testTransformConstants
 {
     id value = nil;
@@ -354,6 +1177,53 @@
     value = @(0x1337);
     value = kRZDBBitwiseComplementTransform(value);
     XCTAssertTrue([value longLongValue] == ~0x1337);
+
+    value = kRZDBLogicalAndReducer(@[@(YES), [NSNull null]]);
+    XCTAssertFalse([value boolValue]);
+
+    value = kRZDBLogicalOrReducer(@[@(NO), [NSNull null], @(YES)]);
+    XCTAssertTrue([value boolValue]);
+
+    value = kRZDBSumReducer(@[@(0.25), [NSNull null], @(2)]);
+    XCTAssertTrue([value doubleValue] == 2.25);
+}
+
+- (void)testTypedTransforms
+{
+    RZDBKeyBindingTransform doubled = rz_doubleTransform(^double (double value) {
+        return 2.0 * value;
+    });
+
+    id value = rz_composeTransforms(@[kRZDBOneMinusTransform, doubled])(@(0.25));
+    XCTAssertTrue([value doubleValue] == 1.5);
+
+    value = rz_composeTransforms(@[kRZDBLogicalNegateTransform, rz_composeTransforms(@[kRZDBLogicalNegateTransform])])(@(YES));
+    XCTAssertTrue([value boolValue]);
+
+    value = rz_composeTransforms(@[kRZDBNilToOneTransform, kRZDBOneMinusTransform])(nil);
+    XCTAssertTrue([value isEqual:@(0)]);
+
+    RZDBTestObject *testObj = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+
+    testObj.number = 0.25;
+    testObj.rect = CGRectMake(0.0f, 0.0f, 10.0f, 10.0f);
+
+    RZDBKeyBindingTransform inset = rz_rectTransform(^CGRect (CGRect rect) {
+        return CGRectInset(rect, 1.0f, 1.0f);
+    });
+
+    [observer rz_bindKey:RZDB_KP_OBJ(observer, number) toKeyPath:RZDB_KP_OBJ(testObj, number) ofObject:testObj withTransform:rz_composeTransforms(@[kRZDBOneMinusTransform, doubled])];
+    [observer rz_bindKey:RZDB_KP_OBJ(observer, rect) toKeyPath:RZDB_KP_OBJ(testObj, rect) ofObject:testObj withTransform:inset];
+
+    XCTAssertTrue(observer.number == 1.5, @"Bound key not transformed on initial binding");
+    XCTAssertTrue(CGRectEqualToRect(observer.rect, CGRectMake(1.0f, 1.0f, 8.0f, 8.0f)), @"Bound key not transformed on initial binding");
+
+    testObj.number = 0.5;
+    testObj.rect = CGRectMake(0.0f, 0.0f, 4.0f, 4.0f);
+
+    XCTAssertTrue(observer.number == 1.0, @"Bound key not transformed when key path changed");
+    XCTAssertTrue(CGRectEqualToRect(observer.rect, CGRectMake(1.0f, 1.0f, 2.0f, 2.0f)), @"Bound key not transformed when key path changed");
 }
 
 - (void)testDeallocation
@@ -390,6 +1260,115 @@
     XCTAssertTrue([[testObjA valueForKey:RZDB_KP_OBJ(testObjA, string)] count] == 0, @"Registered observers were not automatically cleaned up.");
 }
 
+- (void)testBulkCleanup
+{
+    NSMutableArray *targets = [NSMutableArray array];
+    NSMutableArray *sources = [NSMutableArray array];
+
+    for ( NSUInteger i = 0; i < 100; i++ ) {
+        [targets addObject:[RZDBTestObject new]];
+        [sources addObject:[RZDBTestObject new]];
+    }
+
+    __weak RZDBTestObject *weakObserved = nil;
+    __weak RZDBTestObject *weakTarget = nil;
+
+    @autoreleasepool {
+        RZDBTestObject *observed = [RZDBTestObject new];
+        RZDBTestObject *target = [RZDBTestObject new];
+
+        weakObserved = observed;
+        weakTarget = target;
+
+        [observed rz_addTarget:observed action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(observed, number)];
+
+        for ( RZDBTestObject *obj in targets ) {
+            [observed rz_addTarget:obj action:@selector(changeCallback) forKeyPathChanges:@[RZDB_KP_OBJ(observed, string), RZDB_KP_OBJ(observed, number)]];
+            [obj rz_bindKey:RZDB_KP_OBJ(obj, rect) toKeyPath:RZDB_KP_OBJ(observed, rect) ofObject:observed];
+        }
+
+        for ( RZDBTestObject *obj in sources ) {
+            [obj rz_addTarget:target action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(obj, string)];
+            [target rz_bindKey:RZDB_KP_OBJ(target, number) toKeyPath:RZDB_KP_OBJ(obj, number) ofObject:obj];
+        }
+
+        observed.string = @"test";
+        XCTAssertTrue([targets.firstObject callbackCalls] == 1, @"Callback not called before cleanup.");
+    }
+
+    XCTAssertNil(weakObserved, @"Observers prevented object deallocation.");
+    XCTAssertNil(weakTarget, @"Observers prevented target deallocation.");
+
+    // the sources must no longer call the deallocated target, and must still accept new targets
+    for ( RZDBTestObject *obj in sources ) {
+        obj.string = @"changed";
+        obj.number = 1.0f;
+    }
+
+    RZDBTestObject *newTarget = [RZDBTestObject new];
+    [sources.firstObject rz_addTarget:newTarget action:@selector(changeCallback) forKeyPathChange:RZDB_KP_OBJ(newTarget, string)];
+
+    [sources.firstObject setString:@"again"];
+    XCTAssertTrue(newTarget.callbackCalls == 1, @"Target added after cleanup was not called.");
+    XCTAssertTrue([targets.firstObject callbackCalls] == 1, @"Targets were called after the observed object was deallocated.");
+}
+
+- (void)testSharedKeyPathPrefixes
+{
+    RZDBTestObject *root = [RZDBTestObject new];
+    RZDBTestObject *observer = [RZDBTestObject new];
+    RZDBTestObject *boundObj = [RZDBTestObject new];
+
+    RZDBTestObject *oldChild = [RZDBTestObject new];
+    oldChild.child = [RZDBTestObject new];
+    oldChild.child.string = @"a";
+    root.child = oldChild;
+
+    [root rz_addTarget:observer action:@selector(changeCallbackWithDict:) forKeyPathChange:@"child.child.string"];
+    [boundObj rz_bindKey:RZDB_KP_OBJ(boundObj, string) toKeyPath:@"child.child.string" ofObject:root];
+    [boundObj rz_bindKey:RZDB_KP_OBJ(boundObj, number) toKeyPath:@"child.child.number" ofObject:root withTransform:kRZDBNilToZeroTransform];
+
+    XCTAssertEqualObjects(boundObj.string, @"a", @"Binding through a shared prefix should set the initial value.");
+
+    root.child.child.string = @"b";
+
+    XCTAssertTrue(observer.callbackCalls == 1, @"Changing the last key should notify once. Expected:1 Actual:%i", (int)observer.callbackCalls);
+    XCTAssertEqualObjects(boundObj.string, @"b", @"Binding wasn't updated by a change of the last key.");
+
+    RZDBTestObject *newChild = [RZDBTestObject new];
+    newChild.child = [RZDBTestObject new];
+    newChild.child.string = @"c";
+    newChild.child.number = 2.0f;
+    root.child = newChild;
+
+    XCTAssertTrue(observer.callbackCalls == 2, @"Replacing an intermediate object should notify once. Expected:2 Actual:%i", (int)observer.callbackCalls);
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyOld], @"b", @"Replacing an intermediate object should send the previous value of the key path.");
+    XCTAssertEqualObjects(observer.lastChange[kRZDBChangeKeyNew], @"c", @"Replacing an intermediate object should send the new value of the key path.");
+    XCTAssertEqualObjects(boundObj.string, @"c", @"Binding wasn't updated by replacing an intermediate object.");
+    XCTAssertEqual(boundObj.number, 2.0f, @"Every key path below a replaced intermediate object should be updated.");
+
+    oldChild.child.string = @"stale";
+
+    XCTAssertTrue(observer.callbackCalls == 2, @"A replaced intermediate object shouldn't be observed anymore.");
+
+    root.child = nil;
+
+    XCTAssertTrue(observer.callbackCalls == 3, @"Breaking the key path should notify. Expected:3 Actual:%i", (int)observer.callbackCalls);
+    XCTAssertNil(observer.lastChange[kRZDBChangeKeyNew], @"A broken key path should have a nil value.");
+    XCTAssertNil(boundObj.string, @"Binding wasn't updated by breaking the key path.");
+
+    root.child = newChild;
+    [root rz_removeTarget:observer action:@selector(changeCallbackWithDict:) forKeyPathChange:@"child.child.string"];
+    [boundObj rz_unbindKey:RZDB_KP_OBJ(boundObj, string) fromKeyPath:@"child.child.string" ofObject:root];
+    [boundObj rz_unbindKey:RZDB_KP_OBJ(boundObj, number) fromKeyPath:@"child.child.number" ofObject:root];
+
+    newChild.child.string = @"d";
+    root.child = oldChild;
+
+    XCTAssertTrue(observer.callbackCalls == 4, @"Removed targets shouldn't be called. Expected:4 Actual:%i", (int)observer.callbackCalls);
+    XCTAssertEqualObjects(boundObj.string, @"c", @"Unbound keys shouldn't be updated.");
+}
+
 - (void)testProtocolKeypathHelper
 {
     RZDBTestObject *testObject = [RZDBTestObject new];
@@ -0,0 +1,357 @@
+//
+//  rzdb-decode.c
+//  rzdb-decode
+//
+//  Summarizes a recording made by +[RZDBInstrumentation startRecordingToFile:capacity:]. It has no dependencies
+//  beyond libc, so recordings pulled off a device can be decoded on any machine:
+//
+//  cc -O2 -IRZDataBinding Tools/rzdb-decode.c -o rzdb-decode
+//  ./rzdb-decode [-n N] [-d] recording.rzdb
+//
+//  By default this prints the N (default 20) hottest paths by total time spent delivering, and the N key paths
+//  with the largest fan-out. With -d, every record is printed instead, oldest first, as tab-separated columns.
+//  Its kind is one of: change (a KVO change fanned out to observers), deliver (a callback sent or a bound key set),
+//  coalesce (a callback held by an RZDBCoalesce) or commit (a held callback sent when its coalesce committed).
+//
+
+
+// Copyright 2014 Raizlabs and other contributors
+// http://raizlabs.com/
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "RZDBRecordFormat.h"
+
+#pragma mark - Strings
+
+static const char **s_names = NULL;
+static uint32_t s_nameCount = 0;
+
+static void rz_loadStrings(const RZDBRecordFileHeader *header, const char *strings)
+{
+    uint64_t length = (header->stringLength <= header->stringCapacity) ? header->stringLength : header->stringCapacity;
+
+    for ( uint64_t offset = 0; offset + sizeof(RZDBRecordString) <= length; ) {
+        RZDBRecordString entry;
+        memcpy(&entry, strings + offset, sizeof(entry));
+
+        if ( offset + sizeof(entry) + entry.length + 1 > length ) {
+            break;
+        }
+
+        if ( entry.identifier >= s_nameCount ) {
+            uint32_t count = entry.identifier + 1;
+
+            s_names = realloc(s_names, count * sizeof(*s_names));
+            memset(s_names + s_nameCount, 0, (count - s_nameCount) * sizeof(*s_names));
+            s_nameCount = count;
+        }
+
+        s_names[entry.identifier] = strings + offset + sizeof(entry);
+
+        offset += (sizeof(entry) + entry.length + 1 + 3) & ~3ULL;
+    }
+}
+
+// the name of a string ID, or "#ID" if the recording's string table was full
+static const char* rz_name(uint32_t identifier)
+{
+    static char buffers[8][16];
+    static unsigned int next = 0;
+
+    if ( identifier == 0 ) {
+        return "-";
+    }
+    else if ( identifier < s_nameCount && s_names[identifier] != NULL ) {
+        return s_names[identifier];
+    }
+
+    char *buffer = buffers[next++ % 8];
+    snprintf(buffer, sizeof(buffers[0]), "#%" PRIu32, identifier);
+
+    return buffer;
+}
+
+#pragma mark - Aggregation
+
+typedef struct {
+    uint32_t key[4];
+    int used;
+
+    uint64_t count;
+    uint64_t coalesced;
+    uint64_t total;
+    uint64_t max;
+} RZDBAggregate;
+
+typedef struct {
+    RZDBAggregate *entries;
+    size_t capacity;
+    size_t count;
+} RZDBAggregateTable;
+
+static size_t rz_hashKey(const uint32_t key[4])
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for ( int i = 0; i < 4; i++ ) {
+        hash = (hash ^ key[i]) * 1099511628211ULL;
+    }
+
+    return (size_t)hash;
+}
+
+static RZDBAggregate* rz_aggregate(RZDBAggregateTable *table, const uint32_t key[4])
+{
+    if ( (table->count + 1) * 2 > table->capacity ) {
+        RZDBAggregateTable grown = { calloc(table->capacity ? table->capacity * 2 : 64, sizeof(RZDBAggregate)), table->capacity ? table->capacity * 2 : 64, 0 };
+
+        for ( size_t i = 0; i < table->capacity; i++ ) {
+            if ( table->entries[i].used ) {
+                *rz_aggregate(&grown, table->entries[i].key) = table->entries[i];
+                grown.count++;
+            }
+        }
+
+        free(table->entries);
+        *table = grown;
+    }
+
+    size_t mask = table->capacity - 1;
+
+    for ( size_t i = rz_hashKey(key) & mask; ; i = (i + 1) & mask ) {
+        RZDBAggregate *entry = &table->entries[i];
+
+        if ( !entry->used ) {
+            memcpy(entry->key, key, sizeof(entry->key));
+            entry->used = 1;
+            table->count++;
+
+            return entry;
+        }
+        else if ( memcmp(entry->key, key, sizeof(entry->key)) == 0 ) {
+            return entry;
+        }
+    }
+}
+
+static int rz_compareTotals(const void *a, const void *b)
+{
+    uint64_t totalA = ((const RZDBAggregate *)a)->total;
+    uint64_t totalB = ((const RZDBAggregate *)b)->total;
+
+    return (totalA < totalB) - (totalA > totalB);
+}
+
+// moves the used entries to the front, sorted by descending total, and returns how many there are
+static size_t rz_sortAggregates(RZDBAggregateTable *table)
+{
+    size_t count = 0;
+
+    for ( size_t i = 0; i < table->capacity; i++ ) {
+        if ( table->entries[i].used ) {
+            table->entries[count++] = table->entries[i];
+        }
+    }
+
+    qsort(table->entries, count, sizeof(RZDBAggregate), rz_compareTotals);
+
+    return count;
+}
+
+#pragma mark - main
+
+static void rz_usage(void)
+{
+    fprintf(stderr, "usage: rzdb-decode [-n N] [-d] recording\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t limit = 20;
+    int dump = 0;
+    int opt;
+
+    while ( (opt = getopt(argc, argv, "n:d")) != -1 ) {
+        switch ( opt ) {
+            case 'n':
+                limit = (size_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'd':
+                dump = 1;
+                break;
+
+            default:
+                rz_usage();
+        }
+    }
+
+    if ( optind != argc - 1 ) {
+        rz_usage();
+    }
+
+    const char *path = argv[optind];
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+
+    if ( fd < 0 || fstat(fd, &info) != 0 ) {
+        fprintf(stderr, "rzdb-decode: %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    const char *file = ((size_t)info.st_size >= sizeof(RZDBRecordFileHeader)) ? mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    const RZDBRecordFileHeader *header = (const RZDBRecordFileHeader *)file;
+
+    if ( file == MAP_FAILED || memcmp(header->magic, RZDB_RECORD_MAGIC, sizeof(RZDB_RECORD_MAGIC)) != 0 ) {
+        fprintf(stderr, "rzdb-decode: %s: not a recording\n", path);
+        return 1;
+    }
+
+    if ( header->version != RZDB_RECORD_VERSION || header->recordSize != sizeof(RZDBRecord) ) {
+        fprintf(stderr, "rzdb-decode: %s: unsupported version %" PRIu32 "\n", path, header->version);
+        return 1;
+    }
+
+    uint64_t capacity = header->recordCapacity;
+
+    if ( capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+         header->stringOffset + header->stringCapacity > (uint64_t)info.st_size ||
+         header->recordOffset + capacity * sizeof(RZDBRecord) > (uint64_t)info.st_size ) {
+        fprintf(stderr, "rzdb-decode: %s: truncated recording\n", path);
+        return 1;
+    }
+
+    rz_loadStrings(header, file + header->stringOffset);
+
+    const RZDBRecord *records = (const RZDBRecord *)(file + header->recordOffset);
+    uint64_t first = (header->recordCount > capacity) ? header->recordCount - capacity : 0;
+
+    RZDBAggregateTable paths = { NULL, 0, 0 };
+    RZDBAggregateTable fanouts = { NULL, 0, 0 };
+
+    uint64_t changes = 0, delivered = 0, coalesced = 0, incomplete = 0;
+    uint64_t start = UINT64_MAX, end = 0;
+    uint32_t threads = 0;
+
+    if ( dump ) {
+        printf("timestamp\tthread\tkind\tobject\tkeyPath\ttarget\taction\tduration_ns\tfanout\n");
+    }
+
+    for ( uint64_t n = first; n < header->recordCount; n++ ) {
+        const RZDBRecord *record = &records[n & (capacity - 1)];
+
+        // the slot was never written, was being written when recording stopped, or was already being overwritten
+        if ( record->sequence != n + 1 ) {
+            incomplete++;
+            continue;
+        }
+
+        start = (record->timestamp < start) ? record->timestamp : start;
+        end = (record->timestamp > end) ? record->timestamp : end;
+        threads = (record->thread > threads) ? record->thread : threads;
+
+        if ( dump ) {
+            const char *kind = (record->flags & RZDB_RECORD_FLAG_CHANGE) ? "change" :
+                               (record->flags & RZDB_RECORD_FLAG_DELIVERED) ? ((record->flags & RZDB_RECORD_FLAG_COALESCED) ? "commit" : "deliver") : "coalesce";
+
+            printf("%" PRIu64 "\t%" PRIu32 "\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%" PRIu32 "\n",
+                   record->timestamp, record->thread, kind,
+                   rz_name(record->objectClass), rz_name(record->keyPath), rz_name(record->targetClass), rz_name(record->action),
+                   record->duration, record->fanout);
+        }
+
+        if ( record->flags & RZDB_RECORD_FLAG_CHANGE ) {
+            uint32_t key[4] = { record->objectClass, record->keyPath, 0, 0 };
+            RZDBAggregate *aggregate = rz_aggregate(&fanouts, key);
+
+            aggregate->count++;
+            aggregate->total += record->fanout;
+            aggregate->max = (record->fanout > aggregate->max) ? record->fanout : aggregate->max;
+
+            changes++;
+        }
+        else {
+            uint32_t key[4] = { record->objectClass, record->keyPath, record->targetClass, record->action };
+            RZDBAggregate *aggregate = rz_aggregate(&paths, key);
+
+            if ( record->flags & RZDB_RECORD_FLAG_DELIVERED ) {
+                aggregate->count++;
+                aggregate->total += record->duration;
+                aggregate->max = (record->duration > aggregate->max) ? record->duration : aggregate->max;
+
+                delivered++;
+            }
+            else {
+                aggregate->coalesced++;
+                coalesced++;
+            }
+        }
+    }
+
+    if ( dump ) {
+        return 0;
+    }
+
+    printf("%" PRIu64 " records (%" PRIu64 " overwritten, %" PRIu64 " incomplete) from %" PRIu32 " threads over %.3f ms\n",
+           header->recordCount - first - incomplete, first, incomplete, threads, (start <= end) ? (double)(end - start) / 1e6 : 0.0);
+    printf("%" PRIu64 " changes, %" PRIu64 " deliveries, %" PRIu64 " coalesced\n", changes, delivered, coalesced);
+
+    size_t count = rz_sortAggregates(&paths);
+
+    printf("\nhot paths by total delivery time:\n");
+    printf("%12s %10s %10s %10s %10s  %s\n", "total_ns", "delivered", "coalesced", "mean_ns", "max_ns", "object.keyPath -> target action");
+
+    for ( size_t i = 0; i < count && i < limit; i++ ) {
+        RZDBAggregate *aggregate = &paths.entries[i];
+
+        printf("%12" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "  %s.%s -> %s %s\n",
+               aggregate->total, aggregate->count, aggregate->coalesced,
+               aggregate->count ? aggregate->total / aggregate->count : 0, aggregate->max,
+               rz_name(aggregate->key[0]), rz_name(aggregate->key[1]), rz_name(aggregate->key[2]), rz_name(aggregate->key[3]));
+    }
+
+    count = rz_sortAggregates(&fanouts);
+
+    printf("\nfan-out by total observers notified:\n");
+    printf("%12s %10s %10s %10s  %s\n", "notified", "changes", "mean", "max", "object.keyPath");
+
+    for ( size_t i = 0; i < count && i < limit; i++ ) {
+        RZDBAggregate *aggregate = &fanouts.entries[i];
+
+        printf("%12" PRIu64 " %10" PRIu64 " %10.1f %10" PRIu64 "  %s.%s\n",
+               aggregate->total, aggregate->count, (double)aggregate->total / (double)aggregate->count, aggregate->max,
+               rz_name(aggregate->key[0]), rz_name(aggregate->key[1]));
+    }
+
+    return 0;
+}